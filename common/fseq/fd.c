@@ -1,49 +1,251 @@
 /// @file fd.c
-/// @brief Frame data block list implementation.
+/// @brief Frame data ring buffer implementation.
 #include "fd.h"
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "std2/errcode.h"
 
-void FD_free(struct fd_list_s* list) {
-    for (struct fd_node_s* h = list->head; h != NULL;) {
-        struct fd_node_s* next = h->next;
-        free(h->frame);
-        free(h);
-        h = next;
+uint32_t FD_project(const struct fd_range_s* ranges,
+                    const int count,
+                    const uint8_t* src,
+                    uint8_t* dst) {
+    assert(ranges != NULL || count == 0);
+    assert(src != NULL);
+    assert(dst != NULL);
+
+    uint32_t n = 0;
+    for (int i = 0; i < count; i++) {
+        memcpy(&dst[n], &src[ranges[i].first], ranges[i].count);
+        n += ranges[i].count;
     }
-    list->head = list->tail = NULL;
-    list->count = 0;
+    return n;
+}
+
+uint32_t FD_stride(const uint32_t frameSize) {
+    // pad each slot so every frame begins on its own cache line
+    return (frameSize + FD_CACHE_LINE - 1) / FD_CACHE_LINE * FD_CACHE_LINE;
+}
+
+int FD_init(struct fd_ring_s* ring, const uint32_t frameSize, const int cap) {
+    assert(ring != NULL);
+    assert(frameSize > 0);
+    assert(cap > 1);
+
+    memset(ring, 0, sizeof(*ring));
+
+    const uint32_t stride = FD_stride(frameSize);
+
+    // over-allocate to manually align the base, C99 lacks aligned_alloc
+    if ((ring->mem = malloc((size_t) stride * cap + FD_CACHE_LINE)) == NULL)
+        return -FP_ENOMEM;
+
+    const uintptr_t base = (uintptr_t) ring->mem;
+    ring->slots = ring->mem + (FD_CACHE_LINE - base % FD_CACHE_LINE);
+    ring->frameSize = frameSize;
+    ring->stride = stride;
+    ring->cap = cap;
+
+    return FP_EOK;
 }
 
-struct fd_node_s* FD_shift(struct fd_list_s* list) {
-    assert(list != NULL);
+void FD_free(struct fd_ring_s* ring) {
+    assert(ring != NULL);
 
-    struct fd_node_s* head = list->head;
-    if (head == NULL) return NULL;
-    list->head = head->next;
-    if (--list->count == 0) list->tail = NULL;
-    head->next = NULL;// remove linkage once detached from list
-    return head;
+    free(ring->mem);
+    memset(ring, 0, sizeof(*ring));
 }
 
-int FD_append(struct fd_list_s* list, uint8_t* frame) {
-    assert(list != NULL);
-    assert(frame != NULL);
+int FD_space(const struct fd_ring_s* ring) {
+    assert(ring != NULL);
+    return ring->cap - ring->count - 1;
+}
+
+int FD_tail(const struct fd_ring_s* ring) {
+    assert(ring != NULL);
+    return ring->head + ring->count;
+}
+
+uint8_t* FD_slot(const struct fd_ring_s* ring, const int index) {
+    assert(ring != NULL);
+    assert(index >= 0);
+    return &ring->slots[(size_t) (index % ring->cap) * ring->stride];
+}
+
+void FD_commit(struct fd_ring_s* ring, const int n) {
+    assert(ring != NULL);
+    assert(n >= 0 && n <= FD_space(ring));
+    ring->count += n;
+}
+
+void FD_discard(struct fd_ring_s* ring, const int n) {
+    assert(ring != NULL);
+    assert(n >= 0 && n <= ring->count);
+    ring->head = (ring->head + n) % ring->cap;
+    ring->count -= n;
+}
+
+const uint8_t* FD_shift(struct fd_ring_s* ring) {
+    assert(ring != NULL);
+
+    if (ring->count == 0) return NULL;
+    const uint8_t* frame = FD_slot(ring, ring->head);
+    ring->head = (ring->head + 1) % ring->cap;
+    ring->count--;
+    return frame;
+}
+
+int FD_initPack(struct fd_pack_s* pack, const uint32_t frameSize) {
+    assert(pack != NULL);
+    assert(frameSize > 0);
+
+    memset(pack, 0, sizeof(*pack));
+
+    if ((pack->frames[0] = malloc(frameSize)) == NULL ||
+        (pack->frames[1] = malloc(frameSize)) == NULL) {
+        free(pack->frames[0]);
+        return -FP_ENOMEM;
+    }
+    pack->frameSize = frameSize;
+
+    FD_resetPack(pack);
+
+    return FP_EOK;
+}
 
-    struct fd_node_s* node = calloc(1, sizeof(*node));
-    if (node == NULL) return -FP_ENOMEM;
-    node->frame = frame;
+void FD_freePack(struct fd_pack_s* pack) {
+    assert(pack != NULL);
 
-    list->count++;
-    if (list->tail == NULL) {
-        list->head = list->tail = node;
-    } else {
-        list->tail->next = node;
-        list->tail = node;
+    free(pack->b);
+    free(pack->frames[0]);
+    free(pack->frames[1]);
+    memset(pack, 0, sizeof(*pack));
+}
+
+void FD_resetPack(struct fd_pack_s* pack) {
+    assert(pack != NULL);
+
+    pack->size = 0;
+    pack->count = 0;
+    pack->read = 0;
+    pack->pos = 0;
+
+    // the first frame is packed against a blank previous frame
+    memset(pack->frames[1], 0, pack->frameSize);
+}
+
+uint8_t* FD_packSlot(const struct fd_pack_s* pack) {
+    assert(pack != NULL);
+    return pack->frames[0];
+}
+
+/// @def FD_PACK_GAP
+/// @brief Minimum number of unchanged bytes that end a run of changed bytes.
+/// Shorter gaps are copied along with the changed bytes, since skipping them
+/// would cost as much as copying them.
+#define FD_PACK_GAP 4
+
+/// @brief Appends a variable length encoded value, 7 bits per byte.
+/// @param b buffer to append to
+/// @param v value to encode
+/// @return number of bytes written
+static uint32_t FD_putVarint(uint8_t* b, uint32_t v) {
+    uint32_t n = 0;
+    for (; v >= 0x80; v >>= 7) b[n++] = (uint8_t) (v | 0x80);
+    b[n++] = (uint8_t) v;
+    return n;
+}
+
+/// @brief Reads a variable length encoded value written by `FD_putVarint`.
+/// @param b buffer to read from
+/// @param pos read offset, advanced past the value
+/// @return decoded value
+static uint32_t FD_getVarint(const uint8_t* b, uint32_t* pos) {
+    uint32_t v = 0;
+    for (int shift = 0;; shift += 7) {
+        const uint8_t c = b[(*pos)++];
+        v |= (uint32_t) (c & 0x7F) << shift;
+        if (!(c & 0x80)) return v;
+    }
+}
+
+int FD_pack(struct fd_pack_s* pack) {
+    assert(pack != NULL);
+
+    const uint32_t n = pack->frameSize;
+
+    // every pair of runs but the first and last skips at least `FD_PACK_GAP`
+    // bytes and copies at least one, bounding the encoded size of any frame
+    const uint32_t pairs = n / (FD_PACK_GAP + 1) + 2;
+    const uint64_t need = (uint64_t) pack->size + n + pairs * 10;
+    if (need > UINT32_MAX) return -FP_ENOMEM;
+    if (need > pack->cap) {
+        uint32_t cap = pack->cap > 0 ? pack->cap : n;
+        while (cap < need) cap = cap > UINT32_MAX / 2 ? UINT32_MAX : cap * 2;
+
+        uint8_t* b;
+        if ((b = realloc(pack->b, cap)) == NULL) return -FP_ENOMEM;
+        pack->b = b, pack->cap = cap;
+    }
+
+    const uint8_t* curr = pack->frames[0];
+    const uint8_t* prev = pack->frames[1];
+
+    uint8_t* out = pack->b + pack->size;
+    uint32_t w = 0;
+
+    for (uint32_t i = 0; i < n;) {
+        uint32_t j = i;
+        while (j < n && curr[j] == prev[j]) j++;
+
+        // extend the changed run until a long enough unchanged gap follows
+        uint32_t k = j;
+        while (k < n) {
+            if (curr[k] != prev[k]) {
+                k++;
+                continue;
+            }
+            uint32_t e = k;
+            while (e < n && e - k < FD_PACK_GAP && curr[e] == prev[e]) e++;
+            if (e == n || e - k == FD_PACK_GAP) break;
+            k = e;
+        }
+
+        w += FD_putVarint(&out[w], j - i);
+        w += FD_putVarint(&out[w], k - j);
+        memcpy(&out[w], &curr[j], k - j);
+        w += k - j;
+        i = k;
     }
 
+    pack->size += w;
+    pack->count++;
+
+    // the packed frame becomes the previous frame of the next one
+    pack->frames[0] = pack->frames[1];
+    pack->frames[1] = (uint8_t*) curr;
+
     return FP_EOK;
 }
+
+bool FD_unpack(struct fd_pack_s* pack, uint8_t* frame) {
+    assert(pack != NULL);
+    assert(pack->read < pack->count);
+    assert(frame != NULL);
+
+    const bool first = pack->read++ == 0;
+    if (first) memset(frame, 0, pack->frameSize);
+
+    bool changed = first;
+    for (uint32_t i = 0; i < pack->frameSize;) {
+        i += FD_getVarint(pack->b, &pack->pos);
+        const uint32_t k = FD_getVarint(pack->b, &pack->pos);
+        memcpy(&frame[i], &pack->b[pack->pos], k);
+        pack->pos += k, i += k;
+        changed |= k > 0;
+    }
+
+    return changed;
+}
@@ -1,41 +1,162 @@
 /// @file fd.h
-/// @brief Frame data block list utility functions.
+/// @brief Frame data ring buffer utility functions.
 #ifndef FPLAYER_FD_H
 #define FPLAYER_FD_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
-/// @struct fd_list_s
-/// @brief Represents a list of frame data blocks.
-struct fd_list_s {
-    struct fd_node_s* head; ///< First node in the list
-    struct fd_node_s* tail; ///< Last node in the list
-    int count; ///< Number of nodes in the list
+/// @def FD_CACHE_LINE
+/// @brief Alignment in bytes of the ring's backing memory and each frame slot.
+#define FD_CACHE_LINE 64
+
+/// @struct fd_ring_s
+/// @brief Fixed-capacity ring of frame data slots backed by a single
+/// contiguous allocation. Producers write directly into free slots and publish
+/// them with `FD_commit`, consumers borrow the oldest published slot with
+/// `FD_shift`. The ring never allocates once initialized.
+struct fd_ring_s {
+    uint8_t* mem;       ///< Unaligned allocation backing the slots
+    uint8_t* slots;     ///< Cache line aligned address of the first slot
+    uint32_t frameSize; ///< Size of a single frame in bytes
+    uint32_t stride;    ///< Distance between slots, padded to a cache line
+    int cap;            ///< Number of slots in the ring
+    int head;           ///< Slot index of the oldest published frame
+    int count;          ///< Number of published frames
+};
+
+/// @struct fd_range_s
+/// @brief Range of consecutive bytes within a frame.
+struct fd_range_s {
+    uint32_t first; ///< Offset of the first byte in the range
+    uint32_t count; ///< Number of bytes in the range
 };
 
-/// @struct fd_node_s
-/// @brief Represents a node in a list of frame data blocks.
-struct fd_node_s {
-    uint8_t* frame; ///< Frame data block
-    struct fd_node_s* next; ///< Next node in the list
+/// @brief Projects a full frame onto a compact frame holding only the bytes of
+/// the given ranges, copied consecutively in range order.
+/// @param ranges ranges of the source frame to copy
+/// @param count number of ranges
+/// @param src full frame to copy from
+/// @param dst compact frame to copy to, which must hold the sum of all range
+/// sizes in bytes
+/// @return number of bytes written to `dst`
+uint32_t FD_project(const struct fd_range_s* ranges,
+                    int count,
+                    const uint8_t* src,
+                    uint8_t* dst);
+
+/// @brief Returns the distance in bytes between consecutive slots of a ring
+/// holding frames of the given size, including cache line padding. This may be
+/// used to size a ring to fit a memory budget.
+/// @param frameSize size of a single frame in bytes
+/// @return slot stride in bytes
+uint32_t FD_stride(uint32_t frameSize);
+
+/// @brief Allocates the backing memory for a ring of `cap` frame slots of
+/// `frameSize` bytes each. The ring must be freed with `FD_free`.
+/// @param ring pointer to the ring structure to initialize
+/// @param frameSize size of a single frame in bytes
+/// @param cap number of frame slots
+/// @return 0 on success, a negative error code on failure
+int FD_init(struct fd_ring_s* ring, uint32_t frameSize, int cap);
+
+/// @brief Frees the ring's backing memory, but does not free the ring itself.
+/// @param ring pointer to the ring structure to free
+void FD_free(struct fd_ring_s* ring);
+
+/// @brief Returns the number of free slots a producer may write to before
+/// publishing. One slot is always held back so the frame most recently
+/// returned by `FD_shift` remains intact while the caller reads it.
+/// @param ring pointer to the ring structure
+/// @return number of writable slots
+int FD_space(const struct fd_ring_s* ring);
+
+/// @brief Returns the slot index immediately following the last published
+/// frame. Producers write their first frame at this index.
+/// @param ring pointer to the ring structure
+/// @return slot index (unbounded, wrapped by `FD_slot`)
+int FD_tail(const struct fd_ring_s* ring);
+
+/// @brief Returns a pointer to the memory of the given slot index. The index is
+/// wrapped to the ring's capacity. This only depends on fields that are fixed
+/// at initialization, making it safe to call from a producer thread.
+/// @param ring pointer to the ring structure
+/// @param index slot index to address
+/// @return pointer to `frameSize` writable bytes
+uint8_t* FD_slot(const struct fd_ring_s* ring, int index);
+
+/// @brief Publishes the given number of frames written by a producer starting
+/// at `FD_tail`, making them available to `FD_shift`.
+/// @param ring pointer to the ring structure
+/// @param n number of frames to publish, must not exceed `FD_space`
+void FD_commit(struct fd_ring_s* ring, int n);
+
+/// @brief Discards the given number of the oldest published frames without
+/// reading them, freeing their slots for reuse.
+/// @param ring pointer to the ring structure
+/// @param n number of frames to discard, must not exceed the published count
+void FD_discard(struct fd_ring_s* ring, int n);
+
+/// @brief Removes the oldest published frame from the ring and returns a
+/// borrowed, read-only view of it. The view remains valid until the next call
+/// to `FD_shift`.
+/// @param ring pointer to the ring structure
+/// @return pointer to the frame data, or NULL if the ring is empty
+const uint8_t* FD_shift(struct fd_ring_s* ring);
+
+/// @struct fd_pack_s
+/// @brief Set of consecutive frames packed in memory as deltas. Each frame is
+/// stored as alternating runs of bytes unchanged from the previous frame, which
+/// are skipped, and changed bytes, which are copied, with the first frame of a
+/// set packed against a blank frame. Packing is cheap to produce and to expand,
+/// and holds, blackouts and sparse changes pack to a few bytes per frame. Sets
+/// may be linked into a list by their owner.
+struct fd_pack_s {
+    uint8_t* b;             ///< Packed frame data
+    uint32_t size;          ///< Number of bytes of packed frame data
+    uint32_t cap;           ///< Allocated size of \p b in bytes
+    uint8_t* frames[2];     ///< Next frame to pack and the last packed frame
+    uint32_t frameSize;     ///< Size of a single frame in bytes
+    int count;              ///< Number of frames packed
+    int read;               ///< Number of frames unpacked
+    uint32_t pos;           ///< Offset of the next frame to unpack
+    struct fd_pack_s* next; ///< Following set in the owner's list, or NULL
 };
 
-/// @brief Frees all entry nodes in the list, but does not free the list itself.
-/// @param list pointer to the list structure to free
-void FD_free(struct fd_list_s* list);
-
-/// @brief Returns the first node in the list and removes it for consumption by
-/// the caller. The caller is responsible for freeing the returned node.
-/// @param list pointer to the list structure, must be non-NULL and zero initialized
-/// @return the first node in the list, or NULL if the list is empty
-struct fd_node_s* FD_shift(struct fd_list_s* list);
-
-/// @brief Appends a new frame data block to the end of the list. The frame data
-/// provided is not copied, so the caller is responsible for ensuring the memory
-/// remains valid until the frame data block is freed.
-/// @param list pointer to the list structure, must be non-NULL and zero initialized
-/// @param frame frame data to append
+/// @brief Initializes an empty packed frame set for frames of the given size.
+/// The set must be freed with `FD_freePack`.
+/// @param pack pointer to the set to initialize
+/// @param frameSize size of a single frame in bytes
+/// @return 0 on success, a negative error code on failure
+int FD_initPack(struct fd_pack_s* pack, uint32_t frameSize);
+
+/// @brief Frees the set's memory, but does not free the set itself.
+/// @param pack pointer to the set to free
+void FD_freePack(struct fd_pack_s* pack);
+
+/// @brief Empties the set, keeping its memory for reuse.
+/// @param pack pointer to the set to reset
+void FD_resetPack(struct fd_pack_s* pack);
+
+/// @brief Returns the buffer the next frame is written to before it is packed
+/// with `FD_pack`.
+/// @param pack pointer to the set
+/// @return pointer to `frameSize` writable bytes
+uint8_t* FD_packSlot(const struct fd_pack_s* pack);
+
+/// @brief Packs the frame written to `FD_packSlot` onto the end of the set.
+/// @param pack pointer to the set
 /// @return 0 on success, a negative error code on failure
-int FD_append(struct fd_list_s* list, uint8_t* frame);
+int FD_pack(struct fd_pack_s* pack);
+
+/// @brief Expands the next frame of the set in place. The first frame of the
+/// set overwrites `frame` entirely, every following frame only writes the
+/// bytes that changed and `frame` must still hold the previously expanded
+/// frame.
+/// @param pack pointer to the set, which must have frames left to unpack
+/// @param frame frame to expand into
+/// @return true if the frame is the first of the set or differs from the
+/// previous frame, false if it is identical
+bool FD_unpack(struct fd_pack_s* pack, uint8_t* frame);
 
 #endif//FPLAYER_FD_H
@@ -3,16 +3,100 @@
 #include "fc.h"
 
 #include <pthread.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifndef _WIN32
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+
 struct FC {
-    char* fp;              ///< Duplicate of filepath provided to \p FC_open
-    FILE* file;            ///< File handle
-    pthread_mutex_t mutex; ///< Mutex for thread-safe file access
+    char* fp; ///< Duplicate of filepath provided to \p FC_open
+#ifdef _WIN32
+    FILE* file; ///< File handle
+#else
+    int fd; ///< File descriptor, only accessed using positional I/O
+#endif
+    pthread_mutex_t mutex; ///< Guards \p map, and all file access on Windows
+    uint8_t* map;          ///< Read-only file mapping created by \p FC_map
+    size_t mapSize;        ///< Size of \p map in bytes
+    uint8_t* mem;          ///< Buffer given to \p FC_openMem, or NULL
+    uint32_t memSize;      ///< Size of \p mem in bytes
+    bool memWritable;      ///< Writes are copied into \p mem
 };
 
+struct FC* FC_openMem(void* const b,
+                      const uint32_t size,
+                      const enum fc_mode_t mode) {
+    if (b == NULL || (mode != FC_MODE_READ && mode != FC_MODE_WRITE))
+        return NULL;
+    struct FC* fc = calloc(1, sizeof(struct FC));
+    if (fc == NULL) return NULL;
+#ifndef _WIN32
+    fc->fd = -1;// never opened, closing skips it
+#endif
+    fc->mem = b;
+    fc->memSize = size;
+    fc->memWritable = mode == FC_MODE_WRITE;
+    if (pthread_mutex_init(&fc->mutex, NULL) != 0) {
+        free(fc);
+        return NULL;
+    }
+    return fc;
+}
+
+/// @brief Copies bytes out of, or into, the buffer of a memory backed file
+/// controller, stopping at the end of the buffer.
+/// @param fc memory backed file controller
+/// @param offset offset in bytes from the start of the buffer
+/// @param size number of bytes to copy
+/// @param dst buffer to copy into, or NULL to copy into the controller
+/// @param src buffer to copy from, if `dst` is NULL
+/// @return the number of bytes copied
+static size_t FC_memcpy(struct FC* fc,
+                        const uint32_t offset,
+                        size_t size,
+                        uint8_t* const dst,
+                        const uint8_t* const src) {
+    if (offset >= fc->memSize) return 0;
+    if (size > fc->memSize - offset) size = fc->memSize - offset;
+    if (size == 0) return 0;
+    if (dst != NULL)
+        memcpy(dst, &fc->mem[offset], size);
+    else
+        memcpy(&fc->mem[offset], src, size);
+    return size;
+}
+
+/// @brief Scatters a contiguous range of the buffer of a memory backed file
+/// controller across the given buffers in order, see `FC_readv`.
+/// @param fc memory backed file controller
+/// @param offset offset in bytes from the start of the buffer
+/// @param iov buffers to read into
+/// @param count number of buffers
+/// @return the total number of bytes read
+static uint32_t FC_memReadv(struct FC* fc,
+                            const uint32_t offset,
+                            const struct fc_iov_s* iov,
+                            const int count) {
+    uint32_t r = 0;
+    for (int i = 0; i < count; i++) {
+        const size_t n = FC_memcpy(fc, offset + r, iov[i].size, iov[i].b, NULL);
+        r += n;
+        if (n < iov[i].size) break;
+    }
+    return r;
+}
+
+#ifdef _WIN32
+
 struct FC* FC_open(const char* const fp, const enum fc_mode_t mode) {
     char* m;
     switch (mode) {
@@ -48,6 +132,7 @@ uint32_t FC_read(struct FC* fc,
                  const uint32_t offset,
                  const uint32_t size,
                  uint8_t* const b) {
+    if (fc->mem != NULL) return FC_memcpy(fc, offset, size, b, NULL);
     uint32_t r = 0;
     pthread_mutex_lock(&fc->mutex);
     if (fseek(fc->file, offset, SEEK_SET) == 0) r = fread(b, 1, size, fc->file);
@@ -60,6 +145,10 @@ uint32_t FC_readto(struct FC* fc,
                    const uint32_t size,
                    const uint32_t maxCount,
                    uint8_t* const b) {
+    if (fc->mem != NULL) {
+        if (size == 0) return 0;
+        return FC_memcpy(fc, offset, (size_t) size * maxCount, b, NULL) / size;
+    }
     uint32_t r = 0;
     pthread_mutex_lock(&fc->mutex);
     if (fseek(fc->file, offset, SEEK_SET) == 0)
@@ -68,10 +157,31 @@ uint32_t FC_readto(struct FC* fc,
     return r;
 }
 
+uint32_t FC_readv(struct FC* fc,
+                  const uint32_t offset,
+                  const struct fc_iov_s* iov,
+                  const int count) {
+    if (fc->mem != NULL) return FC_memReadv(fc, offset, iov, count);
+    // stdio has no vectored reads, read each buffer in turn under one lock
+    uint32_t r = 0;
+    pthread_mutex_lock(&fc->mutex);
+    if (fseek(fc->file, offset, SEEK_SET) == 0) {
+        for (int i = 0; i < count; i++) {
+            const uint32_t n = fread(iov[i].b, 1, iov[i].size, fc->file);
+            r += n;
+            if (n < iov[i].size) break;
+        }
+    }
+    pthread_mutex_unlock(&fc->mutex);
+    return r;
+}
+
 uint32_t FC_write(struct FC* fc,
                   const uint32_t offset,
                   const uint32_t size,
                   const uint8_t* const b) {
+    if (fc->mem != NULL)
+        return fc->memWritable ? FC_memcpy(fc, offset, size, NULL, b) : 0;
     uint32_t w = 0;
     pthread_mutex_lock(&fc->mutex);
     if (fseek(fc->file, offset, SEEK_SET) == 0)
@@ -81,6 +191,7 @@ uint32_t FC_write(struct FC* fc,
 }
 
 uint32_t FC_filesize(struct FC* fc) {
+    if (fc->mem != NULL) return fc->memSize;
     uint32_t s = 0;
     pthread_mutex_lock(&fc->mutex);
     if (fseek(fc->file, 0, SEEK_END) == 0) s = ftell(fc->file);
@@ -88,3 +199,214 @@ uint32_t FC_filesize(struct FC* fc) {
     pthread_mutex_unlock(&fc->mutex);
     return s;
 }
+
+#else
+
+struct FC* FC_open(const char* const fp, const enum fc_mode_t mode) {
+    int flags;
+    switch (mode) {
+        case FC_MODE_READ:
+            flags = O_RDONLY;
+            break;
+        case FC_MODE_WRITE:
+            flags = O_WRONLY | O_CREAT | O_TRUNC;
+            break;
+        default:
+            return NULL;
+    }
+    struct FC* fc = calloc(1, sizeof(struct FC));
+    if (fc == NULL) return NULL;
+    if ((fc->fd = open(fp, flags, 0644)) < 0 ||
+        (fc->fp = strdup(fp)) == NULL ||
+        pthread_mutex_init(&fc->mutex, NULL) != 0) {
+        perror("FC_open");
+        FC_close(fc);
+        fc = NULL;
+    }
+    return fc;
+}
+
+void FC_close(struct FC* fc) {
+    if (fc == NULL) return;
+    if (fc->map != NULL) munmap(fc->map, fc->mapSize);
+    if (fc->fd >= 0) close(fc->fd);
+    free(fc->fp);
+    pthread_mutex_destroy(&fc->mutex);
+    free(fc);
+}
+
+/// @brief Reads from the file at the given offset until `size` bytes have been
+/// read, the end of the file is reached, or an error occurs. Positional reads
+/// leave the file offset untouched, so concurrent reads need no locking.
+/// @param fd file descriptor to read from
+/// @param offset offset in bytes from the start of the file
+/// @param size number of bytes to read
+/// @param b buffer to read into
+/// @return the number of bytes read
+static size_t FC_pread(const int fd,
+                       const uint32_t offset,
+                       const size_t size,
+                       uint8_t* const b) {
+    size_t r = 0;
+    while (r < size) {
+        const ssize_t n = pread(fd, &b[r], size - r, (off_t) offset + r);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        r += n;
+    }
+    return r;
+}
+
+uint32_t FC_read(struct FC* fc,
+                 const uint32_t offset,
+                 const uint32_t size,
+                 uint8_t* const b) {
+    if (fc->mem != NULL) return FC_memcpy(fc, offset, size, b, NULL);
+    return FC_pread(fc->fd, offset, size, b);
+}
+
+uint32_t FC_readto(struct FC* fc,
+                   const uint32_t offset,
+                   const uint32_t size,
+                   const uint32_t maxCount,
+                   uint8_t* const b) {
+    if (size == 0) return 0;
+    if (fc->mem != NULL)
+        return FC_memcpy(fc, offset, (size_t) size * maxCount, b, NULL) / size;
+    return FC_pread(fc->fd, offset, (size_t) size * maxCount, b) / size;
+}
+
+/// @def FC_IOV_MAX
+/// @brief Maximum number of buffers passed to a single `preadv` call.
+#define FC_IOV_MAX 64
+
+uint32_t FC_readv(struct FC* fc,
+                  const uint32_t offset,
+                  const struct fc_iov_s* iov,
+                  const int count) {
+    if (fc->mem != NULL) return FC_memReadv(fc, offset, iov, count);
+
+    struct iovec v[FC_IOV_MAX];
+
+    uint32_t r = 0;
+    int i = 0;         /* index of the first buffer not yet filled */
+    uint32_t skip = 0; /* bytes of `iov[i]` already filled */
+
+    while (i < count) {
+        int n = 0;
+        for (; n < FC_IOV_MAX && i + n < count; n++) {
+            const uint32_t s = n == 0 ? skip : 0;
+            v[n] = (struct iovec){.iov_base = iov[i + n].b + s,
+                                  .iov_len = iov[i + n].size - s};
+        }
+
+        const ssize_t got = preadv(fc->fd, v, n, (off_t) offset + r);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;// EOF or error
+
+        r += got;
+
+        // advance past the buffers filled by the read, a short read resumes
+        // part way through a buffer
+        size_t left = got;
+        for (; i < count && left >= iov[i].size - skip; i++, skip = 0)
+            left -= iov[i].size - skip;
+        skip += left;
+    }
+
+    return r;
+}
+
+uint32_t FC_write(struct FC* fc,
+                  const uint32_t offset,
+                  const uint32_t size,
+                  const uint8_t* const b) {
+    if (fc->mem != NULL)
+        return fc->memWritable ? FC_memcpy(fc, offset, size, NULL, b) : 0;
+    uint32_t w = 0;
+    while (w < size) {
+        const ssize_t n = pwrite(fc->fd, &b[w], size - w, (off_t) offset + w);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        w += n;
+    }
+    return w;
+}
+
+uint32_t FC_filesize(struct FC* fc) {
+    if (fc->mem != NULL) return fc->memSize;
+    struct stat st;
+    if (fstat(fc->fd, &st) != 0 || st.st_size > UINT32_MAX) return 0;
+    return st.st_size;
+}
+
+#endif
+
+const uint8_t* FC_map(struct FC* fc, size_t* const size) {
+    // memory backed file controllers are already in memory on every platform
+    if (fc->mem != NULL) {
+        *size = fc->memSize;
+        return fc->mem;
+    }
+    *size = 0;
+#ifdef _WIN32
+    (void) fc;
+    return NULL;
+#else
+    pthread_mutex_lock(&fc->mutex);
+    if (fc->map == NULL) {
+        // files beyond the address space are left to reads, which are limited
+        // to the first 4 GiB of the file
+        struct stat st;
+        if (fstat(fc->fd, &st) == 0 && st.st_size > 0) {
+            if ((uintmax_t) st.st_size > SIZE_MAX) {
+                fprintf(stderr, "%s: too large to map, only the first 4 GiB "
+                                "can be read\n",
+                        fc->fp);
+            } else {
+                void* m = mmap(NULL, (size_t) st.st_size, PROT_READ,
+                               MAP_SHARED, fc->fd, 0);
+                if (m != MAP_FAILED) fc->map = m, fc->mapSize = st.st_size;
+            }
+        }
+    }
+    *size = fc->mapSize;
+    pthread_mutex_unlock(&fc->mutex);
+    return fc->map;
+#endif
+}
+
+void FC_advise(struct FC* fc,
+               const size_t offset,
+               const size_t size,
+               const enum fc_advice_t advice) {
+#ifdef _WIN32
+    (void) fc, (void) offset, (void) size, (void) advice;
+#else
+    // memory backed file controllers have nothing to read ahead
+    if (fc->mem != NULL) return;
+
+    // unmapped files are hinted to the page cache by file offset instead,
+    // where supported (macOS lacks posix_fadvise)
+    if (fc->map == NULL) {
+#ifdef POSIX_FADV_SEQUENTIAL
+        const int a = advice == FC_ADVICE_SEQUENTIAL ? POSIX_FADV_SEQUENTIAL
+                                                     : POSIX_FADV_WILLNEED;
+        posix_fadvise(fc->fd, (off_t) offset, (off_t) size, a);
+#endif
+        return;
+    }
+
+    if (offset >= fc->mapSize) return;
+
+    // madvise requires a page aligned address, round the range start down
+    const size_t page = sysconf(_SC_PAGESIZE);
+    const size_t start = offset - offset % page;
+    const size_t end = size > fc->mapSize - offset ? fc->mapSize
+                                                   : offset + size;
+
+    const int a = advice == FC_ADVICE_SEQUENTIAL ? MADV_SEQUENTIAL
+                                                 : MADV_WILLNEED;
+    madvise(&fc->map[start], end - start, a);
+#endif
+}
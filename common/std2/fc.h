@@ -3,11 +3,17 @@
 #ifndef FPLAYER_FC_H
 #define FPLAYER_FC_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 /// @struct FC
-/// @brief File controller that wraps a stdlib file pointer and provides
-/// additional functionality for reading files, including thread-safe access.
+/// @brief File controller that wraps a file and provides additional
+/// functionality for reading files, including thread-safe access. Files are
+/// accessed using positional I/O on a raw file descriptor, without a shared
+/// file offset or stdio buffering, so concurrent reads proceed in parallel
+/// without locking. Windows falls back to a stdlib file pointer guarded by a
+/// mutex. A file controller may instead be backed by a caller-supplied memory
+/// buffer, see `FC_openMem`.
 struct FC;
 
 /// @enum fc_mode_t
@@ -23,6 +29,18 @@ enum fc_mode_t {
 /// @return a file controller instance, or NULL if an error occurred
 struct FC* FC_open(const char* fp, enum fc_mode_t mode);
 
+/// @brief Opens a file controller instance over the given memory buffer in
+/// place of a file. Reads copy directly out of the buffer without any I/O,
+/// `FC_map` returns the buffer itself, and writes copy into the buffer, up to
+/// its size, if opened with `FC_MODE_WRITE`. The buffer is neither copied nor
+/// freed by the file controller, and must outlive it.
+/// @param b buffer holding the file contents, only written to when opened with
+/// `FC_MODE_WRITE`
+/// @param size size of the buffer in bytes, reported as the size of the file
+/// @param mode file open mode
+/// @return a file controller instance, or NULL if an error occurred
+struct FC* FC_openMem(void* b, uint32_t size, enum fc_mode_t mode);
+
 /// @brief Closes the given file controller instance and frees its resources.
 /// @param fc target file controller instance
 void FC_close(struct FC* fc);
@@ -53,6 +71,27 @@ uint32_t FC_readto(struct FC* fc,
                    uint32_t maxCount,
                    uint8_t* b);
 
+/// @struct fc_iov_s
+/// @brief Destination buffer of a vectored read.
+struct fc_iov_s {
+    uint8_t* b;    ///< Buffer to read into
+    uint32_t size; ///< Number of bytes to read into \p b
+};
+
+/// @brief Reads a contiguous range of the file controller starting at the
+/// given offset, scattering it across the given buffers in order. This reads
+/// into many buffers with a single system call where supported.
+/// @param fc target file controller instance
+/// @param offset offset in bytes from the start of the file
+/// @param iov buffers to read into
+/// @param count number of buffers
+/// @return the total number of bytes read, which is less than the combined
+/// size of all buffers if the end of the file was reached or an error occurred
+uint32_t FC_readv(struct FC* fc,
+                  uint32_t offset,
+                  const struct fc_iov_s* iov,
+                  int count);
+
 /// @brief Writes the given number of bytes to the file controller starting at
 /// the given offset.
 /// @param fc target file controller instance
@@ -64,9 +103,41 @@ uint32_t FC_readto(struct FC* fc,
 uint32_t
 FC_write(struct FC* fc, uint32_t offset, uint32_t size, const uint8_t* b);
 
-/// @brief Returns the size of the file backing the given file controller. This
-/// performs a seek to the end of the file to determine its size and then seeks
-/// back to the beginning.
+/// @brief Maps the full file backing the given file controller into memory as
+/// read-only and returns the mapping. The mapping is created on first use and
+/// is retained until the file controller is closed, subsequent calls return the
+/// same mapping. This is intended for file controllers opened with
+/// `FC_MODE_READ` and is unavailable on platforms without `mmap`. Unlike the
+/// 32-bit offsets of the other functions, mappings may exceed 4 GiB where the
+/// address space allows it.
+/// @param fc target file controller instance
+/// @param size out pointer to the size of the mapping in bytes
+/// @return pointer to the start of the mapped file, or NULL if the file could
+/// not be mapped and the caller should fall back to `FC_read`
+const uint8_t* FC_map(struct FC* fc, size_t* size);
+
+/// @enum fc_advice_t
+/// @brief Expected access pattern hints for `FC_advise`.
+enum fc_advice_t {
+    FC_ADVICE_SEQUENTIAL, ///< Range will be accessed in sequential order
+    FC_ADVICE_WILLNEED,   ///< Range will be accessed in the near future
+};
+
+/// @brief Hints the expected access pattern of the given byte range to the
+/// operating system so it can read ahead of, and retain, the data. Mapped file
+/// controllers advise the mapping, ranges are clamped to the size of the file.
+/// Otherwise the hint applies to the page cache used by reads, where supported.
+/// Offsets and sizes are as wide as those of `FC_map`.
+/// @param fc target file controller instance
+/// @param offset offset in bytes from the start of the file
+/// @param size number of bytes covered by the hint
+/// @param advice expected access pattern
+void FC_advise(struct FC* fc,
+               size_t offset,
+               size_t size,
+               enum fc_advice_t advice);
+
+/// @brief Returns the size of the file backing the given file controller.
 /// @param fc target file controller instance
 /// @return the size of the file in bytes, or 0 if an error occurred
 uint32_t FC_filesize(struct FC* fc);
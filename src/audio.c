@@ -3,6 +3,7 @@
 #include "audio.h"
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
 
 #include <AL/alut.h>
@@ -29,10 +30,13 @@ static void perror_alut(const char* const msg) {
 }
 
 static struct {
-    bool init; ///< True if the audio system has been initialized
-    ALuint sid; ///< Allocated source id for audio playback
-    ALuint bid; ///< Allocated buffer id for audio data
-} gAudio; ///< Global audio system state
+    bool init;            ///< True if the audio system has been initialized
+    ALuint sid;           ///< Allocated source id for audio playback
+    ALuint bid;           ///< Allocated buffer id for audio data
+    ALuint nextSid;       ///< Source id loaded by \p Audio_load, or AL_NONE
+    ALuint nextBid;       ///< Buffer id loaded by \p Audio_load, or AL_NONE
+    pthread_mutex_t lock; ///< Guards the above, loads may be made by any thread
+} gAudio = {.lock = PTHREAD_MUTEX_INITIALIZER}; ///< Global audio system state
 
 /// @brief Initializes the audio system if it has not been initialized yet.
 /// @return 0 on success, a negative error code on failure
@@ -46,73 +50,131 @@ static int audioInit(void) {
     return FP_EOK;
 }
 
-/// @brief Stops the current audio playback, if any. The last allocated AL
-/// buffer is then detached from the source and deleted. The source is retained.
-static void audioStopPlayback(void) {
-    if (!gAudio.init) return;
-
-    ALuint sid;
-    if ((sid = gAudio.sid), gAudio.sid = AL_NONE, sid != AL_NONE) {
-        alSourceStop(sid);
-        alSourcei(sid, AL_BUFFER, AL_NONE);
-        alDeleteSources(1, &sid);
+/// @brief Stops the given source, if any, detaches the given buffer from it,
+/// and deletes both. The ids are reset to AL_NONE.
+/// @param sid source id to delete
+/// @param bid buffer id to delete
+static void audioDelete(ALuint* const sid, ALuint* const bid) {
+    ALuint s;
+    if ((s = *sid), *sid = AL_NONE, s != AL_NONE) {
+        alSourceStop(s);
+        alSourcei(s, AL_BUFFER, AL_NONE);
+        alDeleteSources(1, &s);
 
         if (alGetError() != AL_NO_ERROR)
             perror_al("error deleting audio source");
     }
 
-    ALuint bid;
-    if ((bid = gAudio.bid), gAudio.bid = AL_NONE, bid != AL_NONE) {
-        alDeleteBuffers(1, &bid);
+    ALuint b;
+    if ((b = *bid), *bid = AL_NONE, b != AL_NONE) {
+        alDeleteBuffers(1, &b);
         perror_al("error deleting audio buffer");
     }
 }
 
+/// @brief Stops the current audio playback, if any. The last allocated AL
+/// buffer is then detached from the source and both are deleted. Any loaded
+/// audio awaiting `Audio_start` is retained.
+static void audioStopPlayback(void) {
+    if (!gAudio.init) return;
+    audioDelete(&gAudio.sid, &gAudio.bid);
+}
+
 void Audio_exit(void) {
-    bool init;
-    if ((init = gAudio.init), gAudio.init = false, init) {
+    pthread_mutex_lock(&gAudio.lock);
+
+    if (gAudio.init) {
         audioStopPlayback();
+        audioDelete(&gAudio.nextSid, &gAudio.nextBid);
+
+        gAudio.init = false;
 
         alutExit();
         perror_alut("error while exiting ALUT");
     }
+
+    pthread_mutex_unlock(&gAudio.lock);
 }
 
 bool Audio_isPlaying(void) {
-    if (!gAudio.init || gAudio.sid == AL_NONE) return false;
+    pthread_mutex_lock(&gAudio.lock);
 
-    ALint state;
-    alGetSourcei(gAudio.sid, AL_SOURCE_STATE, &state);
-    perror_al("error checking audio source state");
+    ALint state = AL_STOPPED;
+    if (gAudio.init && gAudio.sid != AL_NONE) {
+        alGetSourcei(gAudio.sid, AL_SOURCE_STATE, &state);
+        perror_al("error checking audio source state");
 
-    // free resources if playback has stopped
-    if (state != AL_PLAYING) audioStopPlayback();
+        // free resources if playback has stopped
+        if (state != AL_PLAYING) audioStopPlayback();
+    }
+
+    pthread_mutex_unlock(&gAudio.lock);
 
     return state == AL_PLAYING;
 }
 
-int Audio_play(const char* const fp) {
+int Audio_load(const char* const fp, const float offset) {
     assert(fp != NULL);
 
-    if (Audio_isPlaying()) audioStopPlayback();
-
     // lazy initialize until once an audio playback request is made
     int err;
-    if ((err = audioInit())) return err;
-
-    if ((gAudio.bid = alutCreateBufferFromFile(fp)) == AL_NONE) {
+    pthread_mutex_lock(&gAudio.lock);
+    err = audioInit();
+    pthread_mutex_unlock(&gAudio.lock);
+    if (err) return err;
+
+    // decode without holding the lock, which may take several seconds and
+    // must not block the current playback
+    ALuint bid, sid;
+    if ((bid = alutCreateBufferFromFile(fp)) == AL_NONE) {
         perror_alut("error decoding file into buffer");
         return -FP_EAUDPLAY;
     }
 
-    alGenSources(1, &gAudio.sid);
-    alSourcei(gAudio.sid, AL_BUFFER, gAudio.bid);
+    alGenSources(1, &sid);
+    alSourcei(sid, AL_BUFFER, bid);
+
+    // offsets past the end of the buffer are rejected as an invalid value
+    if (offset > 0) {
+        alSourcef(sid, AL_SEC_OFFSET, offset);
+        if (alGetError() == AL_INVALID_VALUE) {
+            fprintf(stderr, "audio offset %.2fs is beyond end of file\n",
+                    offset);
+            audioDelete(&sid, &bid);
+            return FP_EOK;
+        }
+    }
+
+    // replace any previously loaded audio that was never started
+    pthread_mutex_lock(&gAudio.lock);
+    audioDelete(&gAudio.nextSid, &gAudio.nextBid);
+    gAudio.nextSid = sid, gAudio.nextBid = bid;
+    pthread_mutex_unlock(&gAudio.lock);
+
+    return FP_EOK;
+}
+
+int Audio_start(void) {
+    int err = FP_EOK;
+
+    pthread_mutex_lock(&gAudio.lock);
+
+    if (gAudio.nextSid == AL_NONE) goto ret;
+
+    audioStopPlayback();
+
+    gAudio.sid = gAudio.nextSid, gAudio.nextSid = AL_NONE;
+    gAudio.bid = gAudio.nextBid, gAudio.nextBid = AL_NONE;
+
     alSourcePlay(gAudio.sid);
 
     if (alGetError() != AL_NO_ERROR) {
         perror_al("error starting audio playback");
-        return -FP_EAUDPLAY;
+        err = -FP_EAUDPLAY;
     }
 
-    return FP_EOK;
+ret:
+    pthread_mutex_unlock(&gAudio.lock);
+
+    return err;
 }
@@ -16,12 +16,21 @@ void Audio_exit(void);
 /// audio system has completed playback or failed to start playback)
 bool Audio_isPlaying(void);
 
-/// @brief Attempts to play the audio file at the given file path. This function
-/// initializes the audio system if it has not been initialized yet. If the
-/// audio system is already playing audio, the current audio playback is stopped
-/// before the new audio file is played.
-/// @param fp the file path of the audio file to play
+/// @brief Loads the audio file at the given file path, ready to be played by
+/// `Audio_start`, without interrupting any audio currently playing. This
+/// function initializes the audio system if it has not been initialized yet,
+/// and may be called from any thread. Any previously loaded audio that was
+/// never started is discarded. If the offset is beyond the end of the audio, a
+/// warning is printed and nothing is loaded.
+/// @param fp the file path of the audio file to load
+/// @param offset position in seconds to begin playback from
 /// @return 0 on success, a negative error code on failure
-int Audio_play(const char* fp);
+int Audio_load(const char* fp, float offset);
+
+/// @brief Starts playback of the audio most recently loaded by `Audio_load`.
+/// If the audio system is already playing audio, the current audio playback is
+/// stopped first. If no audio is loaded, this function does nothing.
+/// @return 0 on success, a negative error code on failure
+int Audio_start(void);
 
 #endif//FPLAYER_AUDIO_H
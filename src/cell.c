@@ -3,70 +3,254 @@
 #include "cell.h"
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "tinyfseq.h"
 
 #include "crmap.h"
+#include "diff.h"
+#include "fseq/fd.h"
 #include "std2/errcode.h"
 
-/// @struct cell_s
-/// @brief A single cell in the cell table, repesenting a single output channel.
-struct cell_s {
-    _Bool valid : 1;    ///< True if cell is configured and valid
-    _Bool modified : 1; ///< True if cell has been modified since last check
-    uint8_t unit;       ///< Hardware unit ID for routing
-    uint8_t section;    ///< Circuit ID / 16 for 16-bit proto alignment
-    uint8_t offset;     ///< Circuit ID % 16 for 16-bit proto alignment
-    uint8_t intensity;  ///< Current output intensity
+/// @def CT_SET_WORDS
+/// @brief Returns the number of words of a bitset holding a bit per cell.
+/// @param n number of cells
+/// @return number of bitset words
+#define CT_SET_WORDS(n) (((n) + 63) / 64)
+
+/// @def CT_ROUTE
+/// @brief Packs the routing of a cell into a single value, the index of the
+/// bucket holding its unit and section, and its channel offset in the section.
+/// @param bucket index of the cell's (unit, section) bucket
+/// @param offset channel offset of the cell in its section
+/// @return packed routing value
+#define CT_ROUTE(bucket, offset) ((uint32_t) (bucket) << 4 | (offset))
+
+/// @def CT_ROUTE_BUCKET
+/// @brief Returns the bucket index of a packed routing value.
+#define CT_ROUTE_BUCKET(route) ((route) >> 4)
+
+/// @def CT_ROUTE_OFFSET
+/// @brief Returns the channel offset of a packed routing value.
+#define CT_ROUTE_OFFSET(route) ((route) & 0xF)
+
+/// @struct ct_bucket_s
+/// @brief Routing of the cells sharing a single (unit, section) pair.
+struct ct_bucket_s {
+    uint8_t unit;    ///< Hardware unit ID for routing
+    uint8_t section; ///< Circuit ID / 16 for 16-bit proto alignment
+    uint32_t start;  ///< Offset of the bucket's first cell in the cell list
+    uint32_t count;  ///< Number of cells in the bucket
 };
 
+/// @brief Cells are stored as separate arrays of each of their fields, so the
+/// frame diff and the grouping pass only read the fields they need.
 struct ctable_s {
-    struct cell_s* cells; ///< Array of cells
-    size_t size;         ///< Number of cells in the table
+    uint32_t size;               ///< Number of cells in the table
+    uint8_t* intensity;          ///< Current output intensity of each cell
+    uint32_t* routes;            ///< Packed routing of each cell, `CT_ROUTE`
+    uint64_t* valid;             ///< Bitset of configured and valid cells
+    struct ct_bucket_s* buckets; ///< Routing of each (unit, section) bucket
+    uint32_t bucketCount;        ///< Number of entries in \p buckets
+    uint32_t* bucketCells;       ///< Valid cell indexes, ordered by bucket
+    uint32_t* slots;             ///< Position of each cell in \p bucketCells
+    uint64_t* modified;          ///< Bitset of cells modified since last check,
+                                 ///< by position in \p bucketCells
+    uint64_t* dirty;             ///< Bitset of buckets with a modified cell
+    uint32_t* changed;           ///< Changed bitmap of the last applied range
+    struct ctgroup_s* built;     ///< Groups built by the last grouping pass
+    int* next;                   ///< Next group of each group's bucket, or -1
+    uint64_t* order;             ///< First cell index and index of each group
+    struct ctgroup_s* groups;    ///< Built groups sorted by first cell index
+    uint8_t levels[256];         ///< Output level of each intensity value
 };
 
+/// @def CT_BUCKET_KEYS
+/// @brief Number of distinct (unit, section) pairs addressable by a cell.
+#define CT_BUCKET_KEYS (1 << 16)
+
+/// @brief Returns whether the bit of the given cell is set in a bitset.
+/// @param set bitset to test
+/// @param index index of the cell
+/// @return true if the bit is set
+static inline bool CT_test(const uint64_t* set, const uint32_t index) {
+    return set[index / 64] >> (index % 64) & 1;
+}
+
+/// @brief Marks the cell at the given index as modified, along with the bucket
+/// holding it, so the next grouping pass only visits the cells of buckets with
+/// a modified cell.
+/// @param table table containing the cell
+/// @param index index of the cell
+static inline void CT_modify(struct ctable_s* table, const uint32_t index) {
+    const uint32_t slot = table->slots[index];
+    const uint32_t k = CT_ROUTE_BUCKET(table->routes[index]);
+    table->modified[slot / 64] |= UINT64_C(1) << (slot % 64);
+    table->dirty[k / 64] |= UINT64_C(1) << (k % 64);
+}
+
 int CT_init(const struct cr_s* cmap,
             const uint32_t size,
+            const struct tf_channel_range_t* ranges,
+            const int rangeCount,
             struct ctable_s** table) {
     assert(cmap != NULL);
     assert(size > 0);
+    assert(ranges != NULL || rangeCount == 0);
     assert(table != NULL);
 
     struct ctable_s* t;
-    if ((t = calloc(1, sizeof(struct ctable_s))) == NULL) return -FP_ENOMEM;
+    if ((t = *table = calloc(1, sizeof(struct ctable_s))) == NULL)
+        return -FP_ENOMEM;
 
     t->size = size;
-    if ((t->cells = calloc(size, sizeof(struct cell_s))) == NULL) {
-        free(t);
-        return -FP_ENOMEM;
-    }
+    for (int i = 0; i < 256; i++) t->levels[i] = (uint8_t) i;
+
+    uint32_t* keys = NULL; /* bucket index + 1 of each (unit, section), or 0 */
 
-    *table = t;
+    if ((t->intensity = calloc(size, 1)) == NULL ||
+        (t->routes = calloc(size, sizeof(uint32_t))) == NULL ||
+        (t->valid = calloc(CT_SET_WORDS(size), sizeof(uint64_t))) == NULL ||
+        (t->slots = calloc(size, sizeof(uint32_t))) == NULL ||
+        (t->changed = calloc(DF_WORDS(size), sizeof(uint32_t))) == NULL ||
+        (keys = calloc(CT_BUCKET_KEYS, sizeof(uint32_t))) == NULL)
+        goto err_nomem;
 
-    uint32_t confd = 0; /* number of configured cells */
+    uint32_t confd = 0;   /* number of configured cells */
+    uint32_t buckets = 0; /* number of distinct (unit, section) pairs */
+
+    int r = 0;          /* sparse range containing the current index */
+    uint32_t first = 0; /* frame index of the first channel in range `r` */
 
     for (uint32_t i = 0; i < size; i++) {
-        struct cell_s* c = &t->cells[i];
+        // sparse frames store the channels of each range consecutively,
+        // translate the frame index to the sequence index it stores
+        uint32_t index = i;
+        if (rangeCount > 0) {
+            while (r < rangeCount && i - first >= ranges[r].channelCount)
+                first += ranges[r++].channelCount;
+            if (r == rangeCount) break; /* trailing indexes aren't stored */
+            index = ranges[r].firstChannelNumber + (i - first);
+        }
 
         // attempt to map raw index to known device
+        uint8_t unit;
         uint16_t channel;
-        if (!CMap_lookup(cmap, i, &c->unit, &channel)) {
-            fprintf(stderr, "channel mapping does not cover index %u\n", i);
+        if (!CMap_lookup(cmap, index, &unit, &channel)) {
+            fprintf(stderr, "channel mapping does not cover index %u\n",
+                    index);
             continue;
         }
 
         assert(channel > 0);
 
-        c->valid = 1;
-        c->modified = 1;
-        c->section = (channel - 1) / 16;
-        c->offset = (channel - 1) % 16;
+        const uint8_t section = (channel - 1) / 16;
+        const uint16_t key = (uint16_t) (unit << 8 | section);
+        if (keys[key] == 0) keys[key] = ++buckets;
+
+        t->routes[i] = CT_ROUTE(keys[key] - 1, (channel - 1) % 16);
+        t->valid[i / 64] |= UINT64_C(1) << (i % 64);
 
         confd++;
     }
 
     printf("configured %u/%u indexes\n", confd, size);
 
+    // reserved for at least one cell so an empty table still has its arrays
+    const uint32_t n = confd > 0 ? confd : 1;
+
+    t->bucketCount = buckets;
+
+    if ((t->buckets = calloc(buckets > 0 ? buckets : 1,
+                             sizeof(struct ct_bucket_s))) == NULL ||
+        (t->bucketCells = malloc(n * sizeof(uint32_t))) == NULL ||
+        (t->modified = calloc(CT_SET_WORDS(n), sizeof(uint64_t))) == NULL ||
+        (t->dirty = calloc(CT_SET_WORDS(buckets > 0 ? buckets : 1),
+                           sizeof(uint64_t))) == NULL ||
+        (t->built = malloc(n * sizeof(struct ctgroup_s))) == NULL ||
+        (t->next = malloc(n * sizeof(int))) == NULL ||
+        (t->order = malloc(n * sizeof(uint64_t))) == NULL ||
+        (t->groups = malloc(n * sizeof(struct ctgroup_s))) == NULL)
+        goto err_nomem;
+
+    for (uint32_t k = 0; k < CT_BUCKET_KEYS; k++) {
+        if (keys[k] == 0) continue;
+        struct ct_bucket_s* b = &t->buckets[keys[k] - 1];
+        b->unit = (uint8_t) (k >> 8);
+        b->section = (uint8_t) k;
+    }
+
+    free(keys);
+
+    // list the cells of each bucket together, each in ascending order, by
+    // counting the cells of each bucket to find where its list starts
+    for (uint32_t i = 0; i < size; i++)
+        if (CT_test(t->valid, i))
+            t->buckets[CT_ROUTE_BUCKET(t->routes[i])].count++;
+
+    for (uint32_t k = 0, start = 0; k < buckets; k++) {
+        t->buckets[k].start = start;
+        start += t->buckets[k].count;
+        t->buckets[k].count = 0;
+    }
+
+    // every valid cell begins modified, so the first grouping outputs them all
+    for (uint32_t i = 0; i < size; i++) {
+        if (!CT_test(t->valid, i)) continue;
+        struct ct_bucket_s* b = &t->buckets[CT_ROUTE_BUCKET(t->routes[i])];
+        t->slots[i] = b->start + b->count++;
+        t->bucketCells[t->slots[i]] = i;
+        CT_modify(t, i);
+    }
+
+    return FP_EOK;
+
+err_nomem:
+    free(keys);
+
+    return -FP_ENOMEM;
+}
+
+int CT_ranges(const struct ctable_s* table,
+              const uint32_t gap,
+              struct fd_range_s** ranges,
+              int* const count) {
+    assert(table != NULL);
+    assert(ranges != NULL);
+    assert(count != NULL);
+
+    *ranges = NULL;
+    *count = 0;
+
+    // count the ranges first so they can be allocated at once
+    int n = 0;
+    uint32_t end = 0; /* index following the last configured index */
+    for (uint32_t i = 0; i < table->size; i++) {
+        if (!CT_test(table->valid, i)) continue;
+        if (n == 0 || i - end > gap) n++;
+        end = i + 1;
+    }
+
+    if (n == 0) return FP_EOK;
+
+    struct fd_range_s* r;
+    if ((r = malloc(sizeof(*r) * n)) == NULL) return -FP_ENOMEM;
+
+    // each range is extended over any short unconfigured gap that follows it
+    n = 0;
+    for (uint32_t i = 0; i < table->size; i++) {
+        if (!CT_test(table->valid, i)) continue;
+        if (n == 0 || i - end > gap) r[n++] = (struct fd_range_s){.first = i};
+        end = i + 1;
+        r[n - 1].count = end - r[n - 1].first;
+    }
+
+    *ranges = r;
+    *count = n;
+
     return FP_EOK;
 }
 
@@ -76,10 +260,9 @@ void CT_set(struct ctable_s* table,
     assert(table != NULL);
     assert(index < table->size);
 
-    struct cell_s* c = &table->cells[index];
-    if (!c->valid) return;
-    c->modified = 1;
-    c->intensity = output;
+    if (!CT_test(table->valid, index)) return;
+    CT_modify(table, index);
+    table->intensity[index] = output;
 }
 
 void CT_change(struct ctable_s* table,
@@ -88,56 +271,56 @@ void CT_change(struct ctable_s* table,
     assert(table != NULL);
     assert(index < table->size);
 
-    struct cell_s* c = &table->cells[index];
-    if (!c->valid || c->intensity == output) return;
-    c->modified = 1;
-    c->intensity = output;
-}
+    if (!CT_test(table->valid, index)) return;
 
-/// @brief Checks if two cells match, which indicates they are addressed to the
-/// same hardware controller (unit+section), and have a matching output intensity.
-/// @param a first cell to compare
-/// @param b second cell to compare
-/// @return true if the cells match, false otherwise
-static inline int CT_matches(const struct cell_s* a, const struct cell_s* b) {
-    assert(a != NULL);
-    assert(b != NULL);
-
-    return a->unit == b->unit && a->section == b->section &&
-           a->intensity == b->intensity;
+    // the cell's output level only differs from its intensity's level if the
+    // cell is already modified
+    const uint8_t prev = table->intensity[index];
+    table->intensity[index] = output;
+    if (table->levels[prev] != table->levels[output]) CT_modify(table, index);
 }
 
-/// @def MAX_MATCHES
-/// @brief Maximum number of matching cells to find in a single group.
-/// @note This is derived from the maximum value supported by the protocol. It
-/// is not a software limitation.
-#define MAX_MATCHES 16
-
-/// @brief Finds all cells in the table that match the provided reference cell.
-/// The reference cell must be valid and modified. The matching cells are stored
-/// in the provided array, up to a maximum of `MAX_MATCHES`.
-/// @param table table to search
-/// @param start index to start searching from
-/// @param cmp reference cell to match against
-/// @param matches array to store matching cells
-/// @return the number of matching cells found
-static int CT_findMatches(struct ctable_s* table,
-                          const uint32_t start,
-                          const struct cell_s* cmp,
-                          struct cell_s* matches[MAX_MATCHES]) {
+void CT_apply(struct ctable_s* table,
+              const struct fd_range_s* ranges,
+              const int rangeCount,
+              const uint8_t* frame) {
     assert(table != NULL);
-    assert(cmp != NULL);
-    assert(cmp->valid);
-    assert(cmp->modified);
-    assert(matches != NULL);
-
-    int pos = 0;
-    for (uint32_t i = start; i < table->size; i++) {
-        struct cell_s* c = &table->cells[i];
-        if (c->valid && c->modified && CT_matches(c, cmp)) matches[pos++] = c;
-        if (pos >= MAX_MATCHES) break;
+    assert(ranges != NULL || rangeCount == 0);
+    assert(frame != NULL || rangeCount == 0);
+
+    // the bytes of each range are stored consecutively in the frame, and are
+    // compared directly against the intensities of the range's cells
+    for (int r = 0; r < rangeCount; r++) {
+        const uint32_t first = ranges[r].first;
+        const uint32_t count = ranges[r].count;
+        assert(first + count <= table->size);
+
+        const uint8_t* b = frame;
+        frame += count;
+
+        if (DF_diff(&table->intensity[first], b, count, table->changed) == 0)
+            continue;
+
+        // unconfigured cells inside the range still take the frame's value,
+        // so they do not differ from the following frames again
+        for (uint32_t w = 0; w < DF_WORDS(count); w++) {
+            for (uint32_t bits = table->changed[w]; bits; bits &= bits - 1) {
+                const uint32_t i = w * DF_BLOCK + __builtin_ctz(bits);
+                const uint8_t prev = table->intensity[first + i];
+                table->intensity[first + i] = b[i];
+                if (CT_test(table->valid, first + i) &&
+                    table->levels[prev] != table->levels[b[i]])
+                    CT_modify(table, first + i);
+            }
+        }
     }
-    return pos;
+}
+
+void CT_setLevels(struct ctable_s* table, const uint8_t* levels) {
+    assert(table != NULL);
+    assert(levels != NULL);
+
+    memcpy(table->levels, levels, sizeof(table->levels));
 }
 
 /// @def CHANNEL_BIT
@@ -146,45 +329,119 @@ static int CT_findMatches(struct ctable_s* table,
 /// @return bitmask for the channel index
 #define CHANNEL_BIT(i) (1 << (i))
 
-int CT_groupof(struct ctable_s* table, uint32_t at, struct ctgroup_s* group) {
-    assert(table != NULL);
-    assert(group != NULL);
-
-    *group = (struct ctgroup_s){0};
-
-    struct cell_s* cmp = &table->cells[at];
-    if (!cmp->valid || !cmp->modified) return 0;
-
-    struct cell_s* matches[MAX_MATCHES] = {NULL};
-    const int mc = CT_findMatches(table, at, cmp, matches);
+/// @def CT_ORDER
+/// @brief Returns the sort key of a group, which orders groups by the index of
+/// their first cell and holds the index of the group itself.
+/// @param first index of the first cell of the group
+/// @param group index of the group
+/// @return sort key of the group
+#define CT_ORDER(first, group) ((uint64_t) (first) << 32 | (uint32_t) (group))
+
+/// @brief Compares two group sort keys for sorting in ascending order.
+/// @param a first key
+/// @param b second key
+/// @return negative, zero or positive as `a` is less than, equal to or greater
+/// than `b`
+static int CT_cmpOrder(const void* a, const void* b) {
+    const uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
 
-    assert(mc > 0);// should always find at least one match (the initial input)
-    assert(mc <= MAX_MATCHES);
+int CT_groups(struct ctable_s* table, const struct ctgroup_s** groups) {
+    assert(table != NULL);
+    assert(groups != NULL);
+
+    int n = 0;
+    bool sorted = true; /* groups were built in order of their first cell */
+
+    // only the buckets marked dirty are visited, each modified cell of one is
+    // added to the group of the bucket with a matching intensity, a bucket
+    // holds at most a few groups so they are searched in turn
+    for (uint32_t w = 0; w < CT_SET_WORDS(table->bucketCount); w++) {
+        for (uint64_t bits = table->dirty[w]; bits != 0; bits &= bits - 1) {
+            const struct ct_bucket_s* b =
+                    &table->buckets[w * 64 + __builtin_ctzll(bits)];
+
+            int first = -1; /* first group of the bucket */
+
+            // the bucket's cells are listed together, so its modified cells
+            // are found by scanning its span of the modified bitset
+            const uint32_t end = b->start + b->count;
+            for (uint32_t j = b->start; j < end; j += 64 - j % 64) {
+                const uint32_t base = j - j % 64;
+                uint64_t mask = ~UINT64_C(0) << (j % 64);
+                if (end - base < 64) mask &= (UINT64_C(1) << (end - base)) - 1;
+
+                uint64_t cells = table->modified[j / 64] & mask;
+                table->modified[j / 64] &= ~mask;// consumed by this pass
+
+                for (; cells != 0; cells &= cells - 1) {
+                    const uint32_t index =
+                            table->bucketCells[base + __builtin_ctzll(cells)];
+                    const uint8_t intensity = table->intensity[index];
+                    const uint8_t level = table->levels[intensity];
+
+                    int* link = &first;
+                    while (*link >= 0 &&
+                           table->levels[table->built[*link].intensity] !=
+                                   level)
+                        link = &table->next[*link];
+
+                    if (*link < 0) {
+                        if (n > 0 && index < table->order[n - 1] >> 32)
+                            sorted = false;
+
+                        table->built[n] = (struct ctgroup_s){
+                                .unit = b->unit,
+                                .offset = b->section,
+                                .intensity = intensity,
+                        };
+                        table->next[n] = -1;
+                        table->order[n] = CT_ORDER(index, n);
+                        *link = n++;
+                    }
+
+                    const uint32_t route = table->routes[index];
+                    struct ctgroup_s* g = &table->built[*link];
+                    g->cs |= CHANNEL_BIT(CT_ROUTE_OFFSET(route));
+                    g->size++;
+                }
+            }
+        }
 
-    // group the cells together
-    for (int i = 0; i < mc; i++) {
-        struct cell_s* m = matches[i];
-        assert(m->valid);
-        assert(m->modified);
+        table->dirty[w] = 0;
+    }
 
-        group->cs |= CHANNEL_BIT(m->offset);
+    // groups are ordered by the index of their first cell, as if the table
+    // was scanned in order, which buckets usually already are
+    if (sorted) {
+        *groups = table->built;
+        return n;
+    }
 
-        // first cell in the group, use its data as the group's shared data
-        // (this is already known to match via the hash checking previously)
-        if (group->size++ == 0) {
-            group->offset = m->section;
-            group->unit = m->unit;
-            group->intensity = m->intensity;
-        }
+    qsort(table->order, n, sizeof(uint64_t), CT_cmpOrder);
+    for (int i = 0; i < n; i++)
+        table->groups[i] = table->built[(uint32_t) table->order[i]];
 
-        m->modified = 0;// consume the hash value to prevent re-matching
-    }
+    *groups = table->groups;
 
-    return 1;
+    return n;
 }
 
 void CT_free(struct ctable_s* table) {
     if (table == NULL) return;
-    free(table->cells);
+    free(table->intensity);
+    free(table->routes);
+    free(table->valid);
+    free(table->buckets);
+    free(table->bucketCells);
+    free(table->slots);
+    free(table->modified);
+    free(table->dirty);
+    free(table->changed);
+    free(table->built);
+    free(table->next);
+    free(table->order);
+    free(table->groups);
     free(table);
 }
@@ -12,53 +12,105 @@ struct ctable_s;
 
 struct cr_s;
 
+struct tf_channel_range_t;
+
+struct fd_range_s;
+
 /// @brief Initializes table that maps the raw fseq sequence indexes to a
 /// known LOR unit and channel number using the provided channel map. The lookup
 /// is cached into the table for faster access. The table is dynamically
 /// allocated and must be freed with `CT_free`.
 /// @param cmap channel map to use for lookup
-/// @param size number of indexes to map
+/// @param size number of indexes to map, which is the size of a frame
+/// @param ranges sparse channel ranges stored by each frame, in order, or NULL
+/// if each frame stores every channel starting from 0
+/// @param rangeCount number of sparse channel ranges
 /// @param table pointer to store the table
 /// @return 0 on success, or a negative error code on failure
-int CT_init(const struct cr_s* cmap, uint32_t size, struct ctable_s** table);
+int CT_init(const struct cr_s* cmap,
+            uint32_t size,
+            const struct tf_channel_range_t* ranges,
+            int rangeCount,
+            struct ctable_s** table);
+
+/// @brief Builds the ranges of table indexes covered by the channel map, in
+/// ascending order. Ranges separated by no more than `gap` unconfigured indexes
+/// are merged, trading a few unused bytes for fewer ranges. Indexes outside of
+/// the returned ranges are never output and may be skipped when loading frame
+/// data. The caller is responsible for freeing the ranges.
+/// @param table table to scan
+/// @param gap maximum number of unconfigured indexes merged into a range
+/// @param ranges out pointer to the allocated ranges, or NULL if no index is
+/// configured
+/// @param count out pointer to the number of ranges
+/// @return 0 on success, or a negative error code on failure
+int CT_ranges(const struct ctable_s* table,
+              uint32_t gap,
+              struct fd_range_s** ranges,
+              int* count);
 
 /// @brief Sets the output intensity for the cell at the given index. This marks
 /// the cell as modified, regardless if the new output intensity is the same as
-/// the current value.
+/// the current value. Modified cells are output by the next call to
+/// `CT_groups`.
 /// @param table table to set the output on
 /// @param index index of the cell to set
 /// @param output intensity to set
 void CT_set(struct ctable_s* table, uint32_t index, uint8_t output);
 
 /// @brief Changes the output intensity for the cell at the given index. This
-/// only marks the cell as modified if the new output intensity is different
-/// from the current value.
+/// only marks the cell as modified if the new output intensity is output at a
+/// different level than the current value, see `CT_setLevels`.
 /// @param table table to change the output on
 /// @param index index of the cell to change
 /// @param output intensity to change to
 void CT_change(struct ctable_s* table, uint32_t index, uint8_t output);
 
+/// @brief Applies the next frame to the table, changing the output intensity
+/// of each cell whose value differs from its current intensity, as `CT_change`
+/// would for every cell of the frame. The frame is
+/// compared against the table's intensities a block of cells at a time, so
+/// cells left unchanged by the frame are never visited individually.
+/// @param table table to apply the frame to
+/// @param ranges ranges of table indexes stored by the frame, in the order
+/// they are stored
+/// @param rangeCount number of entries in `ranges`
+/// @param frame frame data holding the bytes of each range consecutively
+void CT_apply(struct ctable_s* table,
+              const struct fd_range_s* ranges,
+              int rangeCount,
+              const uint8_t* frame);
+
+/// @brief Sets the output level each intensity value is sent as. Changes
+/// between intensities of the same level do not modify a cell, and cells of
+/// the same level are grouped together. By default, each intensity value is
+/// its own level.
+/// @param table table to set the levels of
+/// @param levels table of 256 output levels, indexed by intensity value
+void CT_setLevels(struct ctable_s* table, const uint8_t* levels);
+
 /// @struct ctgroup_s
 /// @brief Represents a group of linked cells that share the same unit number,
-/// channel selection bitmask, and output intensity value.
+/// channel selection bitmask, and output level.
 struct ctgroup_s {
     uint8_t unit;      ///< Unit number shared by all channels
     uint8_t offset;    ///< Channel selection offset
     uint16_t cs;       ///< Channel selection bitmask
-    uint8_t intensity; ///< Intensity output value for all channels
+    uint8_t intensity; ///< Intensity of the first cell, at the group's level
     int size;          ///< The number of active channels
 };
 
-/// @brief Returns a group of linked cells starting at the given index. The
-/// group is identified by the unit number, channel section, and output
-/// intensity value. Any cells that have not been modified, or do not match, are
-/// excluded from the grouping. Assuming the cell at `at` is valid and modified,
-/// `group` should always contain at least one cell.
-/// @param table table to search
-/// @param at index to start the group search
-/// @param group pointer to store the group
-/// @return 1 if a group was found, 0 if no group was found
-int CT_groupof(struct ctable_s* table, uint32_t at, struct ctgroup_s* group);
+/// @brief Groups every cell modified since the previous call into groups of
+/// linked cells, and marks them unmodified. Cells are grouped by their unit
+/// number, channel section, and output level. The table tracks
+/// which sections hold a modified cell, so only the cells of those sections
+/// are visited, building each group's channel selection bitmask directly.
+/// Groups are ordered by the lowest index of the cells they contain.
+/// @param table table to group
+/// @param groups out pointer to the groups, which are owned by the table and
+/// remain valid until the next call
+/// @return number of groups
+int CT_groups(struct ctable_s* table, const struct ctgroup_s** groups);
 
 /// @brief Frees the table and any held resources.
 /// @param table table to free
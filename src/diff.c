@@ -0,0 +1,221 @@
+/// @file diff.c
+/// @brief Frame difference implementation.
+#include "diff.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DF_X86
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define DF_NEON
+#endif
+
+/// @brief Compares whole blocks of two frames into a changed bitmap.
+/// @param prev previous frame
+/// @param next frame to compare against \p prev
+/// @param blocks number of `DF_BLOCK` sized blocks to compare
+/// @param changed bitmap of `blocks` words to store the changed bytes in
+typedef void (*df_kernel_t)(const uint8_t* prev,
+                            const uint8_t* next,
+                            uint32_t blocks,
+                            uint32_t* changed);
+
+/// @brief Compares a single block of up to `DF_BLOCK` bytes a byte at a time.
+/// @param prev previous frame block
+/// @param next frame block to compare against \p prev
+/// @param size number of bytes to compare
+/// @return changed bitmap word of the block
+static uint32_t DF_diffBytes(const uint8_t* prev,
+                             const uint8_t* next,
+                             const uint32_t size) {
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < size; i++)
+        if (prev[i] != next[i]) mask |= UINT32_C(1) << i;
+    return mask;
+}
+
+static void DF_diffScalar(const uint8_t* prev,
+                          const uint8_t* next,
+                          const uint32_t blocks,
+                          uint32_t* changed) {
+    for (uint32_t w = 0; w < blocks; w++, prev += DF_BLOCK, next += DF_BLOCK) {
+        // most blocks are unchanged, so each block is checked a word at a
+        // time before building its mask
+        uint64_t x = 0;
+        for (int i = 0; i < DF_BLOCK; i += 8) {
+            uint64_t a, b;
+            memcpy(&a, &prev[i], sizeof(a));
+            memcpy(&b, &next[i], sizeof(b));
+            x |= a ^ b;
+        }
+
+        changed[w] = x ? DF_diffBytes(prev, next, DF_BLOCK) : 0;
+    }
+}
+
+#ifdef DF_X86
+#ifdef __SSE2__
+static void DF_diffSSE2(const uint8_t* prev,
+                        const uint8_t* next,
+                        const uint32_t blocks,
+                        uint32_t* changed) {
+    for (uint32_t w = 0; w < blocks; w++, prev += DF_BLOCK, next += DF_BLOCK) {
+        const __m128i a0 = _mm_loadu_si128((const __m128i*) prev);
+        const __m128i a1 = _mm_loadu_si128((const __m128i*) (prev + 16));
+        const __m128i b0 = _mm_loadu_si128((const __m128i*) next);
+        const __m128i b1 = _mm_loadu_si128((const __m128i*) (next + 16));
+
+        const uint32_t eq =
+                (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(a0, b0)) |
+                (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(a1, b1)) << 16;
+        changed[w] = ~eq;
+    }
+}
+#endif
+
+__attribute__((target("avx2"))) static void
+DF_diffAVX2(const uint8_t* prev,
+            const uint8_t* next,
+            const uint32_t blocks,
+            uint32_t* changed) {
+    for (uint32_t w = 0; w < blocks; w++, prev += DF_BLOCK, next += DF_BLOCK) {
+        const __m256i a = _mm256_loadu_si256((const __m256i*) prev);
+        const __m256i b = _mm256_loadu_si256((const __m256i*) next);
+
+        changed[w] = ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+    }
+}
+#endif
+
+#ifdef DF_NEON
+static void DF_diffNEON(const uint8_t* prev,
+                        const uint8_t* next,
+                        const uint32_t blocks,
+                        uint32_t* changed) {
+    // NEON has no byte mask instruction, each differing byte is weighted by
+    // its bit and the weights are summed pairwise into the mask bytes
+    static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                        1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t wv = vld1q_u8(weights);
+
+    for (uint32_t w = 0; w < blocks; w++, prev += DF_BLOCK, next += DF_BLOCK) {
+        const uint8x16_t ne0 =
+                vmvnq_u8(vceqq_u8(vld1q_u8(prev), vld1q_u8(next)));
+        const uint8x16_t ne1 =
+                vmvnq_u8(vceqq_u8(vld1q_u8(prev + 16), vld1q_u8(next + 16)));
+
+        if (vmaxvq_u8(vorrq_u8(ne0, ne1)) == 0) {
+            changed[w] = 0;
+            continue;
+        }
+
+        uint8x16_t s = vpaddq_u8(vandq_u8(ne0, wv), vandq_u8(ne1, wv));
+        s = vpaddq_u8(s, s);
+        s = vpaddq_u8(s, s);
+        changed[w] = vgetq_lane_u32(vreinterpretq_u32_u8(s), 0);
+    }
+}
+#endif
+
+/// @struct df_kernel_s
+/// @brief Kernel compiled into `DF_diff`.
+struct df_kernel_s {
+    const char* name;        ///< Name of the instruction set used
+    df_kernel_t fn;          ///< Kernel comparing whole blocks
+    bool (*supported)(void); ///< Returns whether the CPU supports it, or NULL
+};
+
+#ifdef DF_X86
+/// @brief Returns whether the running CPU supports AVX2.
+/// @return true if AVX2 is supported
+static bool DF_hasAVX2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+/// @brief Every compiled kernel, ordered from the narrowest to the widest.
+static const struct df_kernel_s DF_kernels[] = {
+        {"scalar", DF_diffScalar, NULL},
+#ifdef DF_X86
+#ifdef __SSE2__
+        {"sse2", DF_diffSSE2, NULL},
+#endif
+        {"avx2", DF_diffAVX2, DF_hasAVX2},
+#elif defined(DF_NEON)
+        {"neon", DF_diffNEON, NULL},
+#endif
+};
+
+/// @def DF_KERNEL_COUNT
+/// @brief Number of compiled kernels.
+#define DF_KERNEL_COUNT (int) (sizeof(DF_kernels) / sizeof(DF_kernels[0]))
+
+static pthread_once_t DF_once = PTHREAD_ONCE_INIT;
+
+/// @brief Compiled kernels supported by the running CPU, in order.
+static const struct df_kernel_s* DF_usable[DF_KERNEL_COUNT];
+
+static int DF_usableCount;
+
+/// @brief Finds the compiled kernels supported by the running CPU, the widest
+/// of which is used by `DF_diff`.
+static void DF_select(void) {
+    for (int i = 0; i < DF_KERNEL_COUNT; i++) {
+        const struct df_kernel_s* k = &DF_kernels[i];
+        if (k->supported == NULL || k->supported())
+            DF_usable[DF_usableCount++] = k;
+    }
+}
+
+uint32_t DF_diffWith(const int kernel,
+                     const uint8_t* prev,
+                     const uint8_t* next,
+                     const uint32_t size,
+                     uint32_t* changed) {
+    assert(prev != NULL || size == 0);
+    assert(next != NULL || size == 0);
+    assert(changed != NULL || size == 0);
+
+    pthread_once(&DF_once, DF_select);
+    assert(kernel >= 0 && kernel < DF_usableCount);
+
+    const uint32_t blocks = size / DF_BLOCK;
+    DF_usable[kernel]->fn(prev, next, blocks, changed);
+
+    const uint32_t tail = size % DF_BLOCK;
+    if (tail > 0) {
+        const uint32_t offset = blocks * DF_BLOCK;
+        changed[blocks] = DF_diffBytes(&prev[offset], &next[offset], tail);
+    }
+
+    uint32_t n = 0;
+    for (uint32_t w = 0; w < DF_WORDS(size); w++)
+        if (changed[w]) n += __builtin_popcount(changed[w]);
+
+    return n;
+}
+
+uint32_t DF_diff(const uint8_t* prev,
+                 const uint8_t* next,
+                 const uint32_t size,
+                 uint32_t* changed) {
+    pthread_once(&DF_once, DF_select);
+    return DF_diffWith(DF_usableCount - 1, prev, next, size, changed);
+}
+
+const char* DF_kernel(void) {
+    pthread_once(&DF_once, DF_select);
+    return DF_usable[DF_usableCount - 1]->name;
+}
+
+const char* DF_kernelAt(const int index) {
+    pthread_once(&DF_once, DF_select);
+    if (index < 0 || index >= DF_usableCount) return NULL;
+    return DF_usable[index]->name;
+}
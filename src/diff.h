@@ -0,0 +1,61 @@
+/// @file diff.h
+/// @brief Frame difference interface.
+#ifndef FPLAYER_DIFF_H
+#define FPLAYER_DIFF_H
+
+#include <stdint.h>
+
+/// @def DF_BLOCK
+/// @brief Number of frame bytes covered by each word of a changed bitmap.
+#define DF_BLOCK 32
+
+/// @def DF_WORDS
+/// @brief Returns the number of words of a changed bitmap covering a frame.
+/// @param size size of the frame
+/// @return number of bitmap words
+#define DF_WORDS(size) (((size) + DF_BLOCK - 1) / DF_BLOCK)
+
+/// @brief Compares two frames and marks each byte that differs between them in
+/// a changed bitmap, where bit `i % DF_BLOCK` of word `i / DF_BLOCK` is set if
+/// byte `i` differs. The frames are compared a block at a time using the
+/// widest vector instructions supported by the CPU, which are selected on the
+/// first call, so unchanged bytes cost a fraction of a compare each.
+/// @param prev previous frame
+/// @param next frame to compare against \p prev
+/// @param size size of both frames
+/// @param changed bitmap of at least `DF_WORDS(size)` words to store the
+/// changed bytes in, which is fully overwritten
+/// @return number of changed bytes
+uint32_t DF_diff(const uint8_t* prev,
+                 const uint8_t* next,
+                 uint32_t size,
+                 uint32_t* changed);
+
+/// @brief Returns the name of the instruction set used by `DF_diff`.
+/// @return name of the instruction set, "scalar" if none is used
+const char* DF_kernel(void);
+
+/// @brief Returns the name of a kernel compiled into `DF_diff` and supported
+/// by the running CPU. Kernels are ordered from the scalar kernel at index 0
+/// to the widest, which is the one used by `DF_diff`.
+/// @param index index of the kernel
+/// @return name of the kernel's instruction set, or NULL if \p index is past
+/// the last supported kernel
+const char* DF_kernelAt(int index);
+
+/// @brief Compares two frames as `DF_diff` does, using the given kernel instead
+/// of the widest one, so each kernel can be checked against the scalar kernel.
+/// @param kernel index of a supported kernel, see `DF_kernelAt`
+/// @param prev previous frame
+/// @param next frame to compare against \p prev
+/// @param size size of both frames
+/// @param changed bitmap of at least `DF_WORDS(size)` words to store the
+/// changed bytes in, which is fully overwritten
+/// @return number of changed bytes
+uint32_t DF_diffWith(int kernel,
+                     const uint8_t* prev,
+                     const uint8_t* next,
+                     uint32_t size,
+                     uint32_t* changed);
+
+#endif//FPLAYER_DIFF_H
@@ -0,0 +1,359 @@
+/// @file encoder.c
+/// @brief Frame output encoding implementation.
+#include "encoder.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cell.h"
+#include "fseq/fd.h"
+#include "hub.h"
+#include "putil.h"
+#include "std2/errcode.h"
+#include "std2/time.h"
+
+/// @struct en_slot_s
+/// @brief Encoded network bytes of a single frame. The buffer is grown as
+/// needed and reused across frames.
+struct en_slot_s {
+    uint8_t* b;     ///< Encoded bytes
+    uint32_t size;  ///< Number of encoded bytes
+    uint32_t cap;   ///< Allocated size of \p b
+    uint32_t frame; ///< Index of the encoded frame
+};
+
+struct encoder_s {
+    struct en_source_s src;           ///< Source to read frames from
+    struct ctable_s* table;           ///< Cell table to apply frames to
+    const struct fd_range_s* ranges;  ///< Frame indexes held by each frame
+    int rangeCount;                   ///< Number of entries in \p ranges
+    uint32_t frame;                   ///< Index of the next frame to read
+    bool pending;                     ///< Table holds unencoded changes
+    struct en_slot_s merged;          ///< Late frames merged for playback
+    struct en_slot_s slots[EN_DEPTH]; ///< Ring of encoded frames
+    int head;                         ///< Slot index of the oldest frame
+    int count;                        ///< Number of encoded frames, held or not
+    bool held;                        ///< Oldest frame is borrowed by playback
+    uint32_t playhead;                ///< Index of the frame due for playback
+    bool done;                        ///< Encoder thread has exited
+    bool quit;                        ///< Requests the encoder thread to exit
+    int err;                          ///< Result the encoder thread exited with
+    struct en_stats_s stats;          ///< Status as of the last encoded frame
+    pthread_t thread;                 ///< Encoder thread
+    pthread_mutex_t lock;             ///< Guards all fields following \p slots
+    pthread_cond_t space;             ///< Signals the thread of freed slots
+};
+
+/// @brief Ensures the slot can hold the given number of additional bytes,
+/// growing it if needed.
+/// @param slot slot to grow
+/// @param n number of additional bytes
+/// @return 0 on success, a negative error code on failure
+static int EN_reserve(struct en_slot_s* slot, const uint32_t n) {
+    assert(slot != NULL);
+
+    if (slot->cap - slot->size >= n) return FP_EOK;
+
+    uint32_t cap = slot->cap > 0 ? slot->cap * 2 : PU_EFFECT_MAX * 64;
+    if (cap - slot->size < n) cap = slot->size + n;
+
+    uint8_t* b;
+    if ((b = realloc(slot->b, cap)) == NULL) return -FP_ENOMEM;
+
+    slot->b = b;
+    slot->cap = cap;
+
+    return FP_EOK;
+}
+
+/// @brief Reads the next frame from the encoder's source.
+/// @param enc encoder to read from
+/// @param fd frame data pointer to return the next frame in
+/// @param repeat pointer to return whether the frame repeats the one before it
+/// @return 0 on success, a negative error code on failure, or 1 if the source
+/// has reached the end of the sequence
+static int EN_read(struct encoder_s* enc, const uint8_t** fd, bool* repeat) {
+    assert(enc != NULL);
+
+    struct frame_pump_s* pump = enc->src.pump;
+    if (pump == NULL)
+        return FH_next(enc->src.hub, enc->src.consumer, fd, repeat);
+
+    int err;
+
+    if ((err = FP_checkPreload(pump))) return err;
+    if ((err = FP_nextFrame(pump, fd))) return err;
+
+    *repeat = FP_isRepeat(pump);
+
+    return FP_EOK;
+}
+
+/// @brief Reads the next frame from the source, applies it to the cell table
+/// and encodes an effect for each changed channel group into the slot. Frames
+/// that are not encoded leave their changes to be encoded with a following
+/// frame.
+/// @param enc encoder to read from
+/// @param slot slot to encode the frame into
+/// @param encode if false, the frame is only applied to the cell table
+/// @return 0 on success, a negative error code on failure, or 1 if the source
+/// has reached the end of the sequence
+static int EN_encode(struct encoder_s* enc,
+                     struct en_slot_s* slot,
+                     const bool encode) {
+    assert(enc != NULL);
+    assert(slot != NULL);
+
+    const uint8_t* frameData = NULL; /* borrowed frame data view */
+
+    bool repeat;
+
+    int err;
+    if ((err = EN_read(enc, &frameData, &repeat))) return err;
+
+    // a repeated frame changes no cell, so it has nothing to encode unless the
+    // changes of a preceding frame that was not encoded are still pending
+    slot->size = 0;
+    if (repeat && !enc->pending) return FP_EOK;
+
+    // update the cell table with latest frame data, the pump only keeps the
+    // bytes of the mapped ranges which are stored consecutively
+    if (!repeat) CT_apply(enc->table, enc->ranges, enc->rangeCount, frameData);
+
+    if (!encode) {
+        enc->pending = true;
+        return FP_EOK;
+    }
+
+    enc->pending = false;
+
+    // encode the effect data for each matching channel group
+    const struct ctgroup_s* groups = NULL;
+    const int n = CT_groups(enc->table, &groups);
+    if ((err = EN_reserve(slot, (uint32_t) n * PU_EFFECT_MAX))) return err;
+    for (int i = 0; i < n; i++)
+        slot->size += PU_encodeEffect(&groups[i], &slot->b[slot->size],
+                                      slot->cap - slot->size);
+
+    return FP_EOK;
+}
+
+/// @brief Thread entry point encoding frames into the encoder's free slots
+/// until the end of the sequence, a failure, or the encoder is freed.
+/// @param pargs encoder to run
+/// @return NULL
+static void* EN_thread(void* pargs) {
+    assert(pargs != NULL);
+
+    struct encoder_s* enc = pargs;
+
+    int err = FP_EOK;
+
+    pthread_mutex_lock(&enc->lock);
+
+    while (!enc->quit) {
+        if (enc->count == EN_DEPTH) {
+            pthread_cond_wait(&enc->space, &enc->lock);
+            continue;
+        }
+
+        // the tail slot is not touched by playback until it is counted, so it
+        // is encoded without the lock held
+        const int tail = (enc->head + enc->count) % EN_DEPTH;
+        struct en_slot_s* slot = &enc->slots[tail];
+
+        // a frame already passed by playback is never output on its own, its
+        // changes are left in the cell table for the next encoded frame
+        const bool late = enc->frame < enc->playhead;
+        pthread_mutex_unlock(&enc->lock);
+
+        const timeInstant start = timeGetNow();
+        err = EN_encode(enc, slot, !late);
+        const int64_t ns = timeElapsedNs(start, timeGetNow());
+
+        pthread_mutex_lock(&enc->lock);
+        if (err) break;
+
+        slot->frame = enc->frame++;
+        if (ns > enc->stats.maxNs) enc->stats.maxNs = ns;
+        if (enc->src.pump != NULL) {
+            FP_getStats(enc->src.pump, &enc->stats.pump);
+            enc->stats.pumpFrames = FP_framesRemaining(enc->src.pump);
+        } else {
+            FH_getStats(enc->src.hub, &enc->stats.pump,
+                        &enc->stats.pumpFrames);
+        }
+
+        if (late) {
+            enc->stats.late++;
+            continue;
+        }
+
+        enc->count++;
+    }
+
+    if (err < 0)
+        fprintf(stderr, "failed to encode next frame: %s %d\n",
+                FP_strerror(err), err);
+
+    enc->err = err;
+    enc->done = true;
+    pthread_mutex_unlock(&enc->lock);
+
+    return NULL;
+}
+
+int EN_init(const struct en_source_s* src,
+            const uint32_t frame,
+            struct ctable_s* table,
+            const struct fd_range_s* ranges,
+            const int rangeCount,
+            struct encoder_s** enc) {
+    assert(src != NULL);
+    assert(src->pump != NULL || src->hub != NULL);
+    assert(table != NULL);
+    assert(ranges != NULL || rangeCount == 0);
+    assert(enc != NULL);
+
+    struct encoder_s* e;
+    if ((e = *enc = calloc(1, sizeof(struct encoder_s))) == NULL)
+        return -FP_ENOMEM;
+
+    e->src = *src;
+    e->frame = e->playhead = frame;
+    e->table = table;
+    e->ranges = ranges;
+    e->rangeCount = rangeCount;
+
+    if (pthread_mutex_init(&e->lock, NULL)) goto err_lock;
+    if (pthread_cond_init(&e->space, NULL)) goto err_space;
+
+    if (pthread_create(&e->thread, NULL, EN_thread, e)) goto err_thread;
+
+    return FP_EOK;
+
+err_thread:
+    pthread_cond_destroy(&e->space);
+err_space:
+    pthread_mutex_destroy(&e->lock);
+err_lock:
+    free(e);
+    *enc = NULL;
+
+    return -FP_EPTHREAD;
+}
+
+/// @brief Copies the encoded bytes of the given number of oldest frames into
+/// the encoder's merged slot, in order, and returns their slots to the encoder
+/// thread.
+/// @param enc encoder to merge the frames of, with its lock held
+/// @param n number of frames to merge
+/// @return 0 on success, a negative error code on failure
+static int EN_merge(struct encoder_s* enc, const int n) {
+    assert(enc != NULL);
+    assert(n > 0 && n <= enc->count);
+
+    struct en_slot_s* merged = &enc->merged;
+    merged->size = 0;
+
+    for (int i = 0; i < n; i++) {
+        const struct en_slot_s* slot = &enc->slots[enc->head];
+
+        int err;
+        if ((err = EN_reserve(merged, slot->size))) return err;
+        if (slot->size > 0)
+            memcpy(&merged->b[merged->size], slot->b, slot->size);
+        merged->size += slot->size;
+
+        enc->head = (enc->head + 1) % EN_DEPTH;
+        enc->count--;
+    }
+
+    pthread_cond_signal(&enc->space);
+
+    return FP_EOK;
+}
+
+int EN_next(struct encoder_s* enc,
+            const uint32_t frame,
+            const uint8_t** b,
+            uint32_t* size) {
+    assert(enc != NULL);
+    assert(b != NULL);
+    assert(size != NULL);
+
+    *b = NULL;
+    *size = 0;
+
+    pthread_mutex_lock(&enc->lock);
+
+    // return the previously borrowed slot to the encoder thread
+    if (enc->held) {
+        enc->head = (enc->head + 1) % EN_DEPTH;
+        enc->count--;
+        enc->held = false;
+        pthread_cond_signal(&enc->space);
+    }
+
+    // frames the encoder reads from here on before this one are late
+    enc->playhead = frame;
+
+    // frames encoded before playback passed them are due along with this one
+    int due = 0;
+    while (due < enc->count &&
+           enc->slots[(enc->head + due) % EN_DEPTH].frame <= frame)
+        due++;
+
+    int err = FP_EOK;
+    if (due == 1) {
+        const struct en_slot_s* slot = &enc->slots[enc->head];
+        *b = slot->b;
+        *size = slot->size;
+        enc->held = true;
+    } else if (due > 1) {
+        if ((err = EN_merge(enc, due)) == FP_EOK) {
+            *b = enc->merged.b;
+            *size = enc->merged.size;
+        }
+    } else if (enc->done && enc->count == 0) {
+        err = enc->err;
+    } else {
+        err = EN_MISSED;
+    }
+
+    pthread_mutex_unlock(&enc->lock);
+
+    return err;
+}
+
+void EN_getStats(struct encoder_s* enc, struct en_stats_s* stats) {
+    assert(enc != NULL);
+    assert(stats != NULL);
+
+    pthread_mutex_lock(&enc->lock);
+    *stats = enc->stats;
+    stats->ready = enc->count - enc->held;
+    pthread_mutex_unlock(&enc->lock);
+}
+
+void EN_free(struct encoder_s* enc) {
+    if (enc == NULL) return;
+
+    pthread_mutex_lock(&enc->lock);
+    enc->quit = true;
+    pthread_cond_signal(&enc->space);
+    pthread_mutex_unlock(&enc->lock);
+
+    pthread_join(enc->thread, NULL);
+
+    pthread_cond_destroy(&enc->space);
+    pthread_mutex_destroy(&enc->lock);
+
+    for (int i = 0; i < EN_DEPTH; i++) free(enc->slots[i].b);
+    free(enc->merged.b);
+    free(enc);
+}
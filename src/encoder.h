@@ -0,0 +1,108 @@
+/// @file encoder.h
+/// @brief Frame output encoding interface.
+#ifndef FPLAYER_ENCODER_H
+#define FPLAYER_ENCODER_H
+
+#include <stdint.h>
+
+#include "pump.h"
+
+struct ctable_s;
+
+struct fd_range_s;
+
+struct frame_hub_s;
+
+/// @struct encoder_s
+/// @brief Encoder state controller for converting frame data into the LOR
+/// network bytes sent at each frame's tick.
+struct encoder_s;
+
+/// @def EN_DEPTH
+/// @brief Number of frames the encoder may have encoded ahead of playback.
+#define EN_DEPTH 8
+
+/// @def EN_MISSED
+/// @brief Result of `EN_next` when the requested frame was not encoded in time.
+#define EN_MISSED 2
+
+/// @struct en_source_s
+/// @brief Source of the frames read by an encoder, either a frame pump read
+/// directly or a consumer of a frame hub shared with other encoders.
+struct en_source_s {
+    struct frame_pump_s* pump; ///< Frame pump read directly, or NULL
+    struct frame_hub_s* hub;   ///< Frame hub read if \p pump is NULL
+    int consumer;              ///< Consumer index of the encoder in \p hub
+};
+
+/// @brief Initializes an encoder and starts its thread, which reads frames
+/// from the source, applies them to the cell table and encodes the resulting
+/// effects for up to `EN_DEPTH` frames ahead of playback. Frames read after
+/// playback has already passed them are applied to the cell table without
+/// being encoded, so their changes are encoded along with the next frame. Once
+/// started, a pump read directly and the table are owned by the encoder thread
+/// and must not be used by the caller until the encoder is freed. The caller
+/// is responsible for freeing the encoder with `EN_free`.
+/// @param src source to read frames from, copied, whose pump or hub must
+/// outlive the encoder
+/// @param frame index of the first frame read from the source
+/// @param table cell table to apply frames to, which must outlive the encoder
+/// @param ranges frame indexes held by each frame read from the source, in the
+/// order they are stored, which must outlive the encoder
+/// @param rangeCount number of entries in `ranges`
+/// @param enc pointer to store the initialized encoder in
+/// @return 0 on success, a negative error code on failure
+int EN_init(const struct en_source_s* src,
+            uint32_t frame,
+            struct ctable_s* table,
+            const struct fd_range_s* ranges,
+            int rangeCount,
+            struct encoder_s** enc);
+
+/// @brief Returns a borrowed, read-only view of the encoded bytes due at the
+/// given frame, without waiting for the encoder thread to produce them. Frames
+/// are requested in ascending order, each at its playback tick. Any frames
+/// encoded after playback passed them are merged into the view, so their
+/// changes are output late rather than lost. If the frame is not encoded
+/// in time, nothing is returned and the caller should keep the previous
+/// frame's output, the frame's changes are instead output with a following
+/// frame once the encoder catches up. The view remains valid until the next
+/// call to `EN_next`.
+/// @param enc encoder to read from
+/// @param frame index of the frame to return
+/// @param b pointer to return the encoded bytes in
+/// @param size pointer to return the number of encoded bytes in, which may be
+/// 0 if the frame did not change any output
+/// @return 0 on success, a negative error code on failure, 1 if the source
+/// has reached the end of the sequence, or `EN_MISSED` if the frame was not
+/// encoded in time
+int EN_next(struct encoder_s* enc,
+            uint32_t frame,
+            const uint8_t** b,
+            uint32_t* size);
+
+/// @struct en_stats_s
+/// @brief Encoder and pump status, as of the most recently encoded frame.
+struct en_stats_s {
+    struct fp_stats_s pump; ///< Read timing reported by the pump
+    int pumpFrames;         ///< Number of frames held by the pump
+    int ready;              ///< Number of frames encoded ahead of playback
+    int64_t maxNs;          ///< Duration of the slowest encode in nanoseconds
+    uint32_t late;          ///< Frames passed by playback before being read
+};
+
+/// @brief Copies the encoder's status. The pump is owned by the encoder
+/// thread, or by the hub the encoder reads from, so its status is only
+/// available through the encoder.
+/// @param enc encoder to check
+/// @param stats pointer to store the status in
+void EN_getStats(struct encoder_s* enc, struct en_stats_s* stats);
+
+/// @brief Stops the encoder thread once any in-progress frame is encoded, and
+/// frees the resources associated with the encoder. The source and table are
+/// not freed. An encoder reading from a hub may be waiting on its next frame,
+/// so the hub must be stopped with `FH_stop` first.
+/// @param enc encoder to free, may be NULL
+void EN_free(struct encoder_s* enc);
+
+#endif//FPLAYER_ENCODER_H
@@ -3,9 +3,9 @@
 #include "comblock.h"
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
-#include <string.h>
 
 #include <zstd.h>
 
@@ -19,207 +19,260 @@
 /// @brief Size of a FSEQ file format compression block entry in bytes.
 #define COMBLOCK_SIZE 8
 
-/// @brief Calculates the absolute address of the given compression block index
-/// and its encoded size.
-/// @param fc target file controller instance
-/// @param seq sequence file for file layout information
-/// @param index index of the compression block to look up
-/// @param cbAddr out pointer to the absolute address of the compression block
-/// @param cbSize out pointer to the size of the compression block
-/// @return 0 on success, a negative error code on failure
-static int ComBlock_findAbsoluteAddr(struct FC* fc,
-                                     const struct tf_header_t* seq,
-                                     const int index,
-                                     uint32_t* const cbAddr,
-                                     uint32_t* const cbSize) {
-    assert(fc != NULL);
-    assert(seq != NULL);
-    assert(cbAddr != NULL);
-    assert(cbSize != NULL);
+void ComBlock_freeDecoder(struct comblock_dec_s* dec) {
+    assert(dec != NULL);
 
-    if (index < 0 || index >= seq->compressionBlockCount) return -FP_ERANGE;
+    ZSTD_freeDCtx(dec->zstd);
+    free(dec->in);
+    free(dec->frame);
 
-    // read each table entry up to and including index
-    // the leading entries are used to calculate the absolute address of a block
-    // additional leading entries may exist but aren't required to calculate the address and are ignored
-    const int tableSize = (index + 1) * COMBLOCK_SIZE;
-
-    uint8_t* const table = malloc(tableSize);
-    if (table == NULL) return -FP_ENOMEM;
-
-    int err = FP_EOK;
+    *dec = (struct comblock_dec_s){
+            .stream = dec->stream,
+            .ranges = dec->ranges,
+            .rangeCount = dec->rangeCount,
+            .pack = dec->pack,
+    };
+}
 
-    // header is 32 bytes, followed by compression block table
-    if (FC_read(fc, 32, tableSize, table) != (uint32_t) tableSize) {
-        err = -FP_ESYSCALL;
-        goto ret;
+/// @brief Positions the decoder at the start of the given compression block,
+/// discarding any buffered input. The decompression context is lazily
+/// allocated, or reset since the previous block may have been abandoned
+/// mid-stream.
+/// @param dec decoder state to position
+/// @param block index entry of the compression block to position at
+/// @return 0 on success, a negative error code on failure
+static int ComBlock_rewind(struct comblock_dec_s* dec,
+                           const struct comblock_s* block) {
+    assert(dec != NULL);
+    assert(block != NULL);
+
+    dec->block = NULL;
+
+    if (dec->zstd == NULL) {
+        if ((dec->zstd = ZSTD_createDCtx()) == NULL) return -FP_ENOMEM;
+    } else if (ZSTD_isError(
+                       ZSTD_DCtx_reset(dec->zstd, ZSTD_reset_session_only))) {
+        return -FP_EZSTD;
     }
 
-    uint8_t* head = table;
-
-    // base absolute address of the first compression block
-    *cbAddr = seq->channelDataOffset;
-    *cbSize = 0;
+    dec->inLen = dec->inPos = 0;
+    dec->block = block;
+    dec->blockRead = 0;
+    dec->at = 0;
 
-    // sum size of each leading compression block to get the absolute address
-    // also read the final block at index to return its size
-    int i = 0;
-    for (; i <= index; i++) {
-        const int remaining = tableSize - i * COMBLOCK_SIZE;
-        assert(remaining > 0);
+    return FP_EOK;
+}
 
-        TFCompressionBlock block;
-        if (TFCompressionBlock_read(head, remaining, &block, &head)) {
-            err = -FP_EINVLBIN;
-            goto ret;
-        }
+/// @brief Reads the next chunk of the positioned block's compressed data into
+/// the decoder's input buffer, growing the buffer if it is too small. Streaming
+/// decoders read up to zstd's recommended input size at a time, otherwise the
+/// remainder of the block is read at once.
+/// @param dec decoder state to read into, which must be positioned in a block
+/// @param fc target file controller instance
+/// @return 0 on success, a negative error code on failure
+static int ComBlock_fill(struct comblock_dec_s* dec, struct FC* fc) {
+    assert(dec != NULL);
+    assert(dec->block != NULL);
+    assert(fc != NULL);
 
-        assert(block.size > 0);
+    const struct comblock_s* block = dec->block;
 
-        // always update to the "last valid" size, even if it isn't the final block
-        *cbSize = block.size;
+    uint32_t size = block->size - dec->blockRead;
+    if (dec->stream && size > ZSTD_DStreamInSize())
+        size = (uint32_t) ZSTD_DStreamInSize();
 
-        // if this isn't the final block, continuing summing the relative offsets
-        // into an absolute position
-        if (i < index) *cbAddr += block.size;
+    if (dec->inSize < size) {
+        uint8_t* in = realloc(dec->in, size);
+        if (in == NULL) return -FP_ENOMEM;
+        dec->in = in, dec->inSize = size;
     }
 
-    // only return success if at least one block was read
-    // this avoids a 0-size block @ 0 from being considered valid
-    if (i == 0) err = -FP_ERANGE;
+    if (FC_read(fc, block->addr + dec->blockRead, size, dec->in) < size)
+        return -FP_ESYSCALL;
 
-ret:
-    free(table);
-    return err;
+    dec->inLen = size, dec->inPos = 0;
+    dec->blockRead += size;
+
+    return FP_EOK;
 }
 
-/// @brief Reads the given compression block (by index) from the given file
-/// controller and decompresses it using zstd.
+/// @brief Reads the given compression block from the given file controller and
+/// decompresses it using zstd. Each frame is decompressed directly into its
+/// ring slot, avoiding any intermediate output buffer, unless the decoder
+/// projects frames in which case each is staged in full before projection.
+/// Packed frames are decompressed into the pack's slot in the same way, and
+/// frames preceding the first frame to write are staged and discarded. The
+/// decoder's buffers are reused, and only (re)allocated when missing or too
+/// small for the block.
+/// @param dec decoder state to reuse for reading the block
 /// @param fc target file controller instance
 /// @param seq sequence file for file layout information
-/// @param index index of the compression block to read
-/// @param list out pointer to the decompressed block data (array of frames) or
-/// NULL on failure
+/// @param block index entry of the compression block to read
+/// @param first index of the first frame to write, relative to the block
+/// @param ring frame ring to decompress into
+/// @param start slot index of the first frame to write
+/// @param room maximum number of frames to write
+/// @param frames out pointer to the number of frames written
 /// @return 0 on success, a negative error code on failure
-static int ComBlock_readZstd(struct FC* fc,
+static int ComBlock_readZstd(struct comblock_dec_s* dec,
+                             struct FC* fc,
                              const struct tf_header_t* seq,
-                             const int index,
-                             struct fd_list_s* list) {
+                             const struct comblock_s* block,
+                             const uint32_t first,
+                             struct fd_ring_s* ring,
+                             const int start,
+                             const int room,
+                             int* const frames) {
+    assert(dec != NULL);
     assert(fc != NULL);
-    assert(index >= 0);
-    assert(list != NULL);
+    assert(block != NULL);
+    assert(ring != NULL || dec->pack != NULL);
+    assert(room > 0);
+    assert(frames != NULL);
+
+    assert(block->addr >= seq->channelDataOffset);
+    assert(block->size > 0);
 
     int err = FP_EOK;
 
-    // attempt to read the address and size of the compression block
-    uint32_t cbAddr = 0, cbSize = 0;
-    if ((err = ComBlock_findAbsoluteAddr(fc, seq, index, &cbAddr, &cbSize)))
-        return err;
+    // continue from the decoder's position if it has not yet passed the first
+    // frame of the block, otherwise decode the block again from its start
+    if ((dec->block != block || dec->at > first) &&
+        (err = ComBlock_rewind(dec, block)))
+        goto ret;
 
-    assert(cbAddr >= seq->channelDataOffset);
-    assert(cbSize > 0);
+    const uint32_t frameSize = seq->channelCount;
 
-    void* dIn = NULL;              /* compressed data input buffer */
-    void* dOut = NULL;             /* decompressed data output buffer */
-    ZSTD_DCtx* ctx = NULL;         /* zstd decompression context */
-    struct fd_list_s cbList = {0}; /* decoded frame data */
+    // projected frames, and frames preceding the first, are staged in full
+    const bool project = dec->ranges != NULL;
+    if ((project || dec->at < first) && dec->frameSize < frameSize) {
+        uint8_t* frame = realloc(dec->frame, frameSize);
+        if (frame == NULL) {
+            err = -FP_ENOMEM;
+            goto ret;
+        }
+        dec->frame = frame, dec->frameSize = frameSize;
+    }
 
-    const size_t dOutSize = ZSTD_DStreamOutSize();
+    struct fd_pack_s* pack = dec->pack;
 
-    // allocate buffers for decompression
-    if ((dIn = malloc(cbSize)) == NULL || (dOut = malloc(dOutSize)) == NULL ||
-        (ctx = ZSTD_createDCtx()) == NULL) {
-        err = -FP_ENOMEM;
-        goto ret;
-    }
+    ZSTD_outBuffer out = {.size = frameSize};
 
-    // read full compression block entry
-    if (FC_read(fc, cbAddr, cbSize, dIn) < cbSize) {
-        err = -FP_ESYSCALL;
-        goto ret;
-    }
+    int n = 0; /* number of completed frames */
 
-    ZSTD_inBuffer in = {.src = dIn, .size = cbSize, .pos = 0};
+    while (n < room) {
+        if (out.pos == 0)
+            out.dst = project || dec->at < first ? dec->frame
+                      : pack                     ? FD_packSlot(pack)
+                                                 : FD_slot(ring, start + n);
 
-    while (in.pos < in.size) {
-        ZSTD_outBuffer out = {.dst = dOut, .size = dOutSize, .pos = 0};
+        // refill the input once the decoder has consumed all of it
+        if (dec->inPos == dec->inLen && dec->blockRead < block->size &&
+            (err = ComBlock_fill(dec, fc)))
+            goto ret;
+
+        ZSTD_inBuffer in = {.src = dec->in,
+                            .size = dec->inLen,
+                            .pos = dec->inPos};
 
-        if (ZSTD_isError(ZSTD_decompressStream(ctx, &out, &in))) {
+        const size_t prev = out.pos;
+
+        if (ZSTD_isError(ZSTD_decompressStream(dec->zstd, &out, &in))) {
             err = -FP_EZSTD;
             goto ret;
         }
 
-        const uint32_t frameSize = seq->channelCount;
+        dec->inPos = (uint32_t) in.pos;
 
-        // the decompressed size should be a product of the frameSize
-        // otherwise the data (is most likely) decompressed incorrectly
-        if (out.pos % frameSize != 0) {
-            err = -FP_EINVLBIN;
-            goto ret;
-        }
+        // advance to the next slot once the current frame is complete
+        if (out.pos == out.size) {
+            out.pos = 0;
+            if (dec->at++ < first) continue; /* preceding frame, discarded */
+
+            if (project)
+                FD_project(dec->ranges, dec->rangeCount, dec->frame,
+                           pack ? FD_packSlot(pack) : FD_slot(ring, start + n));
+            if (pack != NULL && (err = FD_pack(pack))) goto ret;
 
-        // break each chunk into its own allocation
-        // they are appended to a central, ordered table for playback
-        // this enables fplayer to free decompressed frame blocks as they are played
-        for (uint32_t i = 0; i < out.pos / frameSize; i++) {
-            uint8_t* const frame = malloc(frameSize);
-            if (frame == NULL) {
-                err = -FP_ENOMEM;
-                goto ret;
-            }
-
-            const uint8_t* const src = &((uint8_t*) dOut)[i * frameSize];
-            memcpy(frame, src, frameSize);
-
-            if ((err = FD_append(&cbList, frame))) {
-                free(frame);
-                goto ret;
-            }
+            n++;
+            continue;
         }
+
+        // input is consumed and all buffered output has been flushed
+        if (in.pos == in.size && dec->blockRead == block->size &&
+            out.pos == prev)
+            break;
     }
 
+    // any trailing data shorter than a full frame indicates the data was (most
+    // likely) decompressed incorrectly, anything beyond `room` is left for a
+    // following read
+    if (out.pos != 0) err = -FP_EINVLBIN;
+
 ret:
-    free(dIn);
-    free(dOut);
-    ZSTD_freeDCtx(ctx);
-
-    if (err) {
-        FD_free(&cbList);
-    } else {
-        *list = cbList;
-    }
+    // the decoder's position within the block is unknown after a failure
+    if (err) dec->block = NULL;
+
+    *frames = err ? 0 : n;
 
     return err;
 }
 
-int ComBlock_read(struct FC* fc,
+int ComBlock_read(struct comblock_dec_s* dec,
+                  struct FC* fc,
                   const struct tf_header_t* seq,
-                  const int index,
-                  struct fd_list_s* list) {
+                  const struct comblock_s* block,
+                  const uint32_t first,
+                  struct fd_ring_s* ring,
+                  const int start,
+                  const int room,
+                  int* const frames) {
+    assert(dec != NULL);
     assert(fc != NULL);
-    assert(list != NULL);
+    assert(seq != NULL);
+    assert(block != NULL);
+    assert(ring != NULL || dec->pack != NULL);
+    assert(frames != NULL);
 
-    if (index < 0 || index >= seq->compressionBlockCount) return -FP_ERANGE;
+    *frames = 0;
 
     switch (seq->compressionType) {
         case TF_COMPRESSION_ZSTD:
-            return ComBlock_readZstd(fc, seq, index, list);
+            return ComBlock_readZstd(dec, fc, seq, block, first, ring, start,
+                                     room, frames);
         default:
             return -FP_ERANGE;
     }
 }
 
-int ComBlock_count(struct FC* fc, const struct tf_header_t* seq) {
+int ComBlock_index(struct FC* fc,
+                   const struct tf_header_t* seq,
+                   struct comblock_s** blocks,
+                   int* const count) {
     assert(fc != NULL);
     assert(seq != NULL);
+    assert(blocks != NULL);
+    assert(count != NULL);
+
+    *blocks = NULL;
+    *count = 0;
+
+    if (seq->compressionBlockCount == 0) return FP_EOK;
 
     // read the full compression block table as reported by the sequence file
     const int tableSize = seq->compressionBlockCount * COMBLOCK_SIZE;
-    uint8_t* const table = malloc(tableSize);
-    if (table == NULL) return -FP_ENOMEM;
+
+    uint8_t* table = NULL;         /* raw compression block table */
+    struct comblock_s* idx = NULL; /* decoded index entries */
 
     int err = FP_EOK;
 
+    if ((table = malloc(tableSize)) == NULL ||
+        (idx = calloc(seq->compressionBlockCount, sizeof(*idx))) == NULL) {
+        err = -FP_ENOMEM;
+        goto ret;
+    }
+
     // header is 32 bytes, followed by compression block table
     if (FC_read(fc, 32, tableSize, table) != (uint32_t) tableSize) {
         err = -FP_ESYSCALL;
@@ -228,9 +281,13 @@ int ComBlock_count(struct FC* fc, const struct tf_header_t* seq) {
 
     uint8_t* head = table;
 
-    int i = 0;
-    for (; i < seq->compressionBlockCount; i++) {
-        const int remaining = tableSize - i * COMBLOCK_SIZE;
+    // base absolute address of the first compression block, each following
+    // block is stored immediately after the previous one
+    uint32_t addr = seq->channelDataOffset;
+
+    int n = 0;
+    for (; n < seq->compressionBlockCount; n++) {
+        const int remaining = tableSize - n * COMBLOCK_SIZE;
         assert(remaining > 0);
 
         TFCompressionBlock block;
@@ -239,11 +296,39 @@ int ComBlock_count(struct FC* fc, const struct tf_header_t* seq) {
             goto ret;
         }
 
+        // other encoding programs are known to pad the table with zero-sized
+        // entries to align write operations, these are not playable blocks
         if (block.size == 0) break;
+
+        if (block.size > UINT32_MAX - addr ||
+            (n > 0 && block.firstFrameId < idx[n - 1].firstFrame)) {
+            err = -FP_EINVLBIN;
+            goto ret;
+        }
+
+        idx[n] = (struct comblock_s){
+                .addr = addr,
+                .size = block.size,
+                .firstFrame = block.firstFrameId,
+        };
+
+        addr += block.size;
     }
 
+    // each block spans from its first frame up to the first frame of the next
+    // block, with the final block spanning to the end of the sequence
+    for (int i = 0; i < n; i++) {
+        const uint32_t end =
+                i + 1 < n ? idx[i + 1].firstFrame : seq->frameCount;
+        idx[i].frames = end > idx[i].firstFrame ? end - idx[i].firstFrame : 0;
+    }
+
+    *blocks = idx, idx = NULL;
+    *count = n;
+
 ret:
     free(table);
+    free(idx);
 
-    return err ? err : i;
+    return err;
 }
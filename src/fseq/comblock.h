@@ -3,35 +3,118 @@
 #ifndef FPLAYER_COMBLOCK_H
 #define FPLAYER_COMBLOCK_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 struct FC;
 
 struct tf_header_t;
 
-struct fd_list_s;
+struct fd_ring_s;
+
+struct fd_range_s;
+
+struct fd_pack_s;
+
+struct comblock_s;
+
+struct ZSTD_DCtx_s;
 
-/// @brief Reads the given compression block (by index) from the given file
-/// controller and decompresses it (if supported).
+/// @struct comblock_dec_s
+/// @brief Reusable decompression state for reading compression blocks. The
+/// decompression context and compressed input buffer are allocated on first
+/// use and kept across blocks, with the input buffer grown to fit the largest
+/// block read so far. The decoder remains positioned within the most recently
+/// read block, allowing a following read of the same block to continue from
+/// the next frame without decoding the block again. Streaming decoders read
+/// the compressed input in chunks of zstd's recommended input size rather than
+/// whole blocks, so their memory use does not grow with the block size. A
+/// decoder may optionally project each decoded frame onto a set of byte
+/// ranges, in which case frames are decoded into a staging buffer and only
+/// the bytes of the ranges are copied to the ring, see `FD_project`. A decoder
+/// may instead pack frames into a set rather than writing them to the ring,
+/// see `FD_pack`. A decoder must not be used by multiple threads at once.
+struct comblock_dec_s {
+    struct ZSTD_DCtx_s* zstd;        ///< zstd decompression context, or NULL
+    uint8_t* in;                     ///< Compressed input buffer
+    uint32_t inSize;                 ///< Allocated size of \p in in bytes
+    uint32_t inLen;                  ///< Number of bytes held by \p in
+    uint32_t inPos;                  ///< Number of bytes of \p in consumed
+    bool stream;                     ///< Reads input in bounded chunks
+    const struct comblock_s* block;  ///< Block positioned within, or NULL
+    uint32_t blockRead;              ///< Compressed bytes of \p block read
+    uint32_t at;                     ///< Frames of \p block decoded
+    const struct fd_range_s* ranges; ///< Frame bytes to keep, or NULL for all
+    int rangeCount;                  ///< Number of entries in \p ranges
+    uint8_t* frame;                  ///< Full frame staging buffer
+    uint32_t frameSize;              ///< Allocated size of \p frame in bytes
+    struct fd_pack_s* pack;          ///< Set to pack frames into, or NULL
+};
+
+/// @brief Frees the resources held by the decoder, but not the decoder itself.
+/// The decoder's configuration is kept, and it may be reused afterwards.
+/// @param dec decoder to free
+void ComBlock_freeDecoder(struct comblock_dec_s* dec);
+
+/// @struct comblock_s
+/// @brief Compression block index entry, locating a block's compressed data
+/// within the sequence file and the range of frames it decodes to.
+struct comblock_s {
+    uint32_t addr;       ///< Absolute file offset of the compressed data
+    uint32_t size;       ///< Size of the compressed data in bytes
+    uint32_t firstFrame; ///< Index of the first frame decoded by the block
+    uint32_t frames;     ///< Number of frames spanned by the block
+};
+
+/// @brief Reads the given compression block from the given file controller and
+/// decompresses it (if supported) into consecutive slots of the frame ring,
+/// projecting each frame if the decoder is configured to do so. The frames are
+/// not published to the ring, the caller is responsible for calling `FD_commit`
+/// with the returned count. If the decoder is configured with a pack, frames
+/// are instead appended to it and the ring is not used. Decoding begins at the
+/// given frame of the block, continuing from the decoder's position if it was
+/// left there by a previous read, otherwise decoding the block from its start
+/// and discarding the frames preceding it.
+/// @param dec decoder state to reuse for reading the block
 /// @param fc target file controller instance
 /// @param seq sequence file for file layout information
-/// @param index index of the compression block to read
-/// @param list pointer to the list for storing the decompressed frame data
+/// @param block index entry of the compression block to read, which must remain
+/// at the same address while the decoder is positioned within it
+/// @param first index of the first frame to write, relative to the block
+/// @param ring frame ring to decompress into, or NULL if the decoder packs
+/// @param start slot index of the first frame to write
+/// @param room maximum number of frames to write, any additional frames in the
+/// block are left for a following read
+/// @param frames out pointer to the number of frames written
 /// @return 0 on success, a negative error code on failure
-int ComBlock_read(struct FC* fc,
+int ComBlock_read(struct comblock_dec_s* dec,
+                  struct FC* fc,
                   const struct tf_header_t* seq,
-                  int index,
-                  struct fd_list_s* list);
-
-/// @brief Determines the number of compression blocks available within the
-/// given sequence file. The FSEQ file header already contains a field,
-/// `compressionBlockCount`, that specifies the number of compression blocks,
-/// but other encoding programs are known to write additional zero-sized
-/// compression blocks to align write operations. This results in a discrepancy
-/// between the header field and the actual number of playable blocks in the
-/// sequence file.
+                  const struct comblock_s* block,
+                  uint32_t first,
+                  struct fd_ring_s* ring,
+                  int start,
+                  int room,
+                  int* frames);
+
+/// @brief Reads the sequence file's compression block table once and builds
+/// an index of each block's absolute file offset (the prefix sum of all
+/// preceding block sizes), size and frame span, allowing any block to be
+/// located without further table reads. The FSEQ file header already contains
+/// a field, `compressionBlockCount`, that specifies the number of compression
+/// blocks, but other encoding programs are known to write additional
+/// zero-sized compression blocks to align write operations. The index stops at
+/// the first zero-sized entry, and `count` reflects the number of playable
+/// blocks. The caller is responsible for freeing the index.
 /// @param fc target file controller instance
 /// @param seq sequence file for file layout information
-/// @return the number of compression blocks on success or a negative error code
-/// on failure
-int ComBlock_count(struct FC* fc, const struct tf_header_t* seq);
+/// @param blocks out pointer to the allocated index, or NULL if there are no
+/// playable blocks
+/// @param count out pointer to the number of index entries
+/// @return 0 on success, a negative error code on failure
+int ComBlock_index(struct FC* fc,
+                   const struct tf_header_t* seq,
+                   struct comblock_s** blocks,
+                   int* count);
 
 #endif//FPLAYER_COMBLOCK_H
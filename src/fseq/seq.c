@@ -14,35 +14,112 @@
 
 #include "comblock.h"
 
-int Seq_open(struct FC* fc, struct tf_header_t** seq) {
+/// @def RANGE_SIZE
+/// @brief Size of a FSEQ file format sparse channel range entry in bytes.
+#define RANGE_SIZE 6
+
+/// @brief Reads the sparse channel range table, which follows the compression
+/// block table as written (including any zero-sized padding entries). The sum
+/// of all range sizes must not exceed the frame size.
+/// @param fc target file controller instance
+/// @param seq sequence to populate with the decoded ranges, the header's
+/// `compressionBlockCount` must not have been corrected yet
+/// @return 0 on success, a negative error code on failure
+static int Seq_readRanges(struct FC* fc, struct seq_s* seq) {
+    assert(fc != NULL);
+    assert(seq != NULL);
+
+    const struct tf_header_t* header = &seq->header;
+    if (header->channelRangeCount == 0) return FP_EOK;
+
+    const uint32_t tableAddr = 32 + header->compressionBlockCount * 8;
+    const int tableSize = header->channelRangeCount * RANGE_SIZE;
+
+    uint8_t* const table = malloc(tableSize);
+    if (table == NULL) return -FP_ENOMEM;
+
+    int err = FP_EOK;
+
+    if (FC_read(fc, tableAddr, tableSize, table) != (uint32_t) tableSize) {
+        err = -FP_ESYSCALL;
+        goto ret;
+    }
+
+    if ((seq->ranges = calloc(header->channelRangeCount,
+                              sizeof(TFChannelRange))) == NULL) {
+        err = -FP_ENOMEM;
+        goto ret;
+    }
+
+    uint8_t* head = table;
+    uint32_t stored = 0; /* number of channels stored by each frame */
+
+    for (int i = 0; i < header->channelRangeCount; i++) {
+        const int remaining = tableSize - i * RANGE_SIZE;
+
+        TFChannelRange* range = &seq->ranges[i];
+        if (TFChannelRange_read(head, remaining, range, &head) ||
+            range->channelCount > header->channelCount - stored) {
+            err = -FP_EINVLBIN;
+            goto ret;
+        }
+
+        stored += range->channelCount;
+    }
+
+ret:
+    free(table);
+
+    return err;
+}
+
+int Seq_open(struct FC* fc, struct seq_s** seq) {
     assert(fc != NULL);
     assert(seq != NULL);
 
     uint8_t b[32] = {0};
     if (!FC_read(fc, 0, sizeof(b), b)) return -FP_ESYSCALL;
 
-    if ((*seq = calloc(1, sizeof(struct tf_header_t))) == NULL)
-        return -FP_ENOMEM;
+    if ((*seq = calloc(1, sizeof(struct seq_s))) == NULL) return -FP_ENOMEM;
 
-    if (TFHeader_read(b, sizeof(b), *seq, NULL)) {
-        free(*seq), *seq = NULL;
+    struct tf_header_t* header = &(*seq)->header;
+
+    if (TFHeader_read(b, sizeof(b), header, NULL)) {
+        Seq_free(*seq), *seq = NULL;
         return -FP_EINVLBIN;
     }
 
-    // rewrite compression block to exclude potential zero-sized entries
-    if ((*seq)->compressionType != TF_COMPRESSION_NONE) {
-        const int res = ComBlock_count(fc, *seq);
-        if (res < 0) {
-            free(*seq), *seq = NULL;
-            return res;
+    // the range table is located using the block count as written, so it is
+    // read before the block count is corrected below
+    int err;
+    if ((err = Seq_readRanges(fc, *seq))) {
+        Seq_free(*seq), *seq = NULL;
+        return err;
+    }
+
+    // index the compression block table, and rewrite the block count to
+    // exclude potential zero-sized entries
+    if (header->compressionType != TF_COMPRESSION_NONE) {
+        int count;
+        if ((err = ComBlock_index(fc, header, &(*seq)->blocks, &count))) {
+            Seq_free(*seq), *seq = NULL;
+            return err;
         }
 
-        (*seq)->compressionBlockCount = res;
+        header->compressionBlockCount = count;
     }
 
     return FP_EOK;
 }
 
+void Seq_free(struct seq_s* seq) {
+    if (seq == NULL) return;
+
+    free(seq->blocks);
+    free(seq->ranges);
+    free(seq);
+}
+
 /// @def VARHEADER_SIZE
 /// @brief Size of a FSEQ file format variable header in bytes.
 #define VARHEADER_SIZE 4
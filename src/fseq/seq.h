@@ -3,16 +3,36 @@
 #ifndef FPLAYER_SEQ_H
 #define FPLAYER_SEQ_H
 
+#include "tinyfseq.h"
+
 struct FC;
 
-struct tf_header_t;
+struct comblock_s;
+
+/// @struct seq_s
+/// @brief Opened sequence file metadata, the decoded FSEQ header alongside any
+/// lookup tables built from the file's layout.
+struct seq_s {
+    struct tf_header_t header; ///< Decoded sequence file metadata header
+    struct comblock_s* blocks; ///< Compression block index, with
+                               ///< `header.compressionBlockCount` entries
+    TFChannelRange* ranges;    ///< Sparse channel ranges stored by each frame,
+                               ///< with `header.channelRangeCount` entries
+};
 
-/// @brief Reads a FSEQ header and initializes the header struct with the
-/// sequence's metadata. The caller is responsible for freeing the header.
+/// @brief Reads a FSEQ header and initializes the sequence struct with the
+/// sequence's metadata. Compressed sequences also have their compression block
+/// table indexed. Sparse sequences have their channel range table decoded,
+/// each frame then only stores the channels of each range, in order. The
+/// caller is responsible for freeing the sequence with `Seq_free`.
 /// @param fc target file controller instance
-/// @param seq the sequence header to populate with the FSEQ metadata
+/// @param seq the sequence to populate with the FSEQ metadata
 /// @return 0 on success, a negative error code on failure
-int Seq_open(struct FC* fc, struct tf_header_t** seq);
+int Seq_open(struct FC* fc, struct seq_s** seq);
+
+/// @brief Frees the sequence and its lookup tables.
+/// @param seq sequence to free, may be NULL
+void Seq_free(struct seq_s* seq);
 
 /// @brief Retrieves the audio file path from the sequence for playback by
 /// searching the FSEQ's variable table for the `mf` (media file) variable.
@@ -0,0 +1,238 @@
+/// @file hub.c
+/// @brief Shared frame distribution implementation.
+#include "hub.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "std2/errcode.h"
+
+/// @struct fh_slot_s
+/// @brief Copy of a single published frame.
+struct fh_slot_s {
+    uint8_t* frame; ///< Frame data, of the hub's frame size
+    bool repeat;    ///< Frame is identical to the frame before it
+    int refs;       ///< Number of consumers yet to release the frame
+};
+
+/// @struct fh_consumer_s
+/// @brief Read position of a single consumer.
+struct fh_consumer_s {
+    uint64_t next; ///< Index of the next frame to return
+    bool held;     ///< Frame before \p next is borrowed by the consumer
+};
+
+struct frame_hub_s {
+    struct frame_pump_s* pump;        ///< Frame pump to read frames from
+    uint32_t frameSize;               ///< Size of each frame
+    int consumerCount;                ///< Number of entries in \p consumers
+    struct fh_consumer_s* consumers;  ///< Read position of each consumer
+    struct fh_slot_s slots[FH_DEPTH]; ///< Ring of published frames
+    uint64_t head;                    ///< Index of the oldest held frame
+    uint64_t tail;                    ///< Index of the next published frame
+    struct fp_stats_s stats;          ///< Pump statistics, as of \p tail
+    int pumpFrames;                   ///< Pump frames remaining, as of \p tail
+    bool done;                        ///< Hub thread has exited
+    bool quit;                        ///< Requests the hub thread to exit
+    int err;                          ///< Result the hub thread exited with
+    pthread_t thread;                 ///< Hub thread
+    pthread_mutex_t lock;             ///< Guards all fields following \p slots
+    pthread_cond_t ready;             ///< Signals consumers of new frames
+    pthread_cond_t space;             ///< Signals the thread of freed slots
+};
+
+/// @brief Thread entry point reading frames from the pump into the hub's free
+/// slots until the end of the sequence, a failure, or the hub is stopped.
+/// @param pargs hub to run
+/// @return NULL
+static void* FH_thread(void* pargs) {
+    assert(pargs != NULL);
+
+    struct frame_hub_s* hub = pargs;
+
+    int err = FP_EOK;
+
+    pthread_mutex_lock(&hub->lock);
+
+    while (!hub->quit) {
+        if (hub->tail - hub->head == FH_DEPTH) {
+            pthread_cond_wait(&hub->space, &hub->lock);
+            continue;
+        }
+
+        // the tail slot is not touched by consumers until it is published, so
+        // it is written without the lock held
+        struct fh_slot_s* slot = &hub->slots[hub->tail % FH_DEPTH];
+        pthread_mutex_unlock(&hub->lock);
+
+        const uint8_t* frameData = NULL; /* borrowed frame data view */
+
+        if ((err = FP_checkPreload(hub->pump)) == FP_EOK &&
+            (err = FP_nextFrame(hub->pump, &frameData)) == FP_EOK) {
+            memcpy(slot->frame, frameData, hub->frameSize);
+            slot->repeat = FP_isRepeat(hub->pump);
+        }
+
+        struct fp_stats_s stats;
+        FP_getStats(hub->pump, &stats);
+        const int pumpFrames = FP_framesRemaining(hub->pump);
+
+        pthread_mutex_lock(&hub->lock);
+        if (err) break;
+
+        slot->refs = hub->consumerCount;
+        hub->stats = stats;
+        hub->pumpFrames = pumpFrames;
+        hub->tail++;
+        pthread_cond_broadcast(&hub->ready);
+    }
+
+    if (err < 0)
+        fprintf(stderr, "failed to read next frame: %s %d\n", FP_strerror(err),
+                err);
+
+    hub->err = err;
+    hub->done = true;
+    pthread_cond_broadcast(&hub->ready);
+    pthread_mutex_unlock(&hub->lock);
+
+    return NULL;
+}
+
+int FH_init(struct frame_pump_s* pump,
+            const uint32_t frameSize,
+            const int consumers,
+            struct frame_hub_s** hub) {
+    assert(pump != NULL);
+    assert(consumers > 0);
+    assert(hub != NULL);
+
+    struct frame_hub_s* h;
+    if ((h = *hub = calloc(1, sizeof(struct frame_hub_s))) == NULL)
+        return -FP_ENOMEM;
+
+    h->pump = pump;
+    h->frameSize = frameSize;
+    h->consumerCount = consumers;
+
+    int err = -FP_ENOMEM;
+
+    if ((h->consumers = calloc(consumers, sizeof(struct fh_consumer_s))) ==
+        NULL)
+        goto err_slots;
+    for (int i = 0; i < FH_DEPTH; i++)
+        if ((h->slots[i].frame = malloc(frameSize)) == NULL)
+            goto err_slots;
+
+    err = -FP_EPTHREAD;
+
+    if (pthread_mutex_init(&h->lock, NULL)) goto err_slots;
+
+    if (pthread_cond_init(&h->ready, NULL)) goto err_ready;
+    if (pthread_cond_init(&h->space, NULL)) goto err_space;
+
+    if (pthread_create(&h->thread, NULL, FH_thread, h)) goto err_thread;
+
+    return FP_EOK;
+
+err_thread:
+    pthread_cond_destroy(&h->space);
+err_space:
+    pthread_cond_destroy(&h->ready);
+err_ready:
+    pthread_mutex_destroy(&h->lock);
+err_slots:
+    for (int i = 0; i < FH_DEPTH; i++) free(h->slots[i].frame);
+    free(h->consumers);
+    free(h);
+    *hub = NULL;
+
+    return err;
+}
+
+int FH_next(struct frame_hub_s* hub,
+            const int consumer,
+            const uint8_t** fd,
+            bool* repeat) {
+    assert(hub != NULL);
+    assert(consumer >= 0 && consumer < hub->consumerCount);
+    assert(fd != NULL);
+    assert(repeat != NULL);
+
+    struct fh_consumer_s* c = &hub->consumers[consumer];
+
+    pthread_mutex_lock(&hub->lock);
+
+    // release the previously borrowed frame, consumers release frames in
+    // order so every frame before the last released one is released as well
+    if (c->held) {
+        c->held = false;
+        if (--hub->slots[(c->next - 1) % FH_DEPTH].refs == 0) {
+            while (hub->head < hub->tail &&
+                   hub->slots[hub->head % FH_DEPTH].refs == 0)
+                hub->head++;
+            pthread_cond_signal(&hub->space);
+        }
+    }
+
+    while (!hub->quit && !hub->done && c->next == hub->tail)
+        pthread_cond_wait(&hub->ready, &hub->lock);
+
+    int err = FP_EOK;
+    if (hub->quit) {
+        err = 1;
+    } else if (c->next == hub->tail) {
+        err = hub->err;
+    } else {
+        const struct fh_slot_s* slot = &hub->slots[c->next % FH_DEPTH];
+        *fd = slot->frame;
+        *repeat = slot->repeat;
+        c->next++;
+        c->held = true;
+    }
+
+    pthread_mutex_unlock(&hub->lock);
+
+    return err;
+}
+
+void FH_getStats(struct frame_hub_s* hub,
+                 struct fp_stats_s* stats,
+                 int* frames) {
+    assert(hub != NULL);
+    assert(stats != NULL);
+    assert(frames != NULL);
+
+    pthread_mutex_lock(&hub->lock);
+    *stats = hub->stats;
+    *frames = hub->pumpFrames;
+    pthread_mutex_unlock(&hub->lock);
+}
+
+void FH_stop(struct frame_hub_s* hub) {
+    if (hub == NULL) return;
+
+    pthread_mutex_lock(&hub->lock);
+    hub->quit = true;
+    pthread_cond_broadcast(&hub->ready);
+    pthread_cond_signal(&hub->space);
+    pthread_mutex_unlock(&hub->lock);
+}
+
+void FH_free(struct frame_hub_s* hub) {
+    if (hub == NULL) return;
+
+    FH_stop(hub);
+    pthread_join(hub->thread, NULL);
+
+    pthread_cond_destroy(&hub->space);
+    pthread_cond_destroy(&hub->ready);
+    pthread_mutex_destroy(&hub->lock);
+
+    for (int i = 0; i < FH_DEPTH; i++) free(hub->slots[i].frame);
+    free(hub->consumers);
+    free(hub);
+}
@@ -0,0 +1,76 @@
+/// @file hub.h
+/// @brief Shared frame distribution interface.
+#ifndef FPLAYER_HUB_H
+#define FPLAYER_HUB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pump.h"
+
+/// @struct frame_hub_s
+/// @brief Frame hub state controller for sharing the frames of a single pump
+/// between multiple consumers.
+struct frame_hub_s;
+
+/// @def FH_DEPTH
+/// @brief Number of frames the hub may hold ahead of its slowest consumer.
+#define FH_DEPTH 16
+
+/// @brief Initializes a frame hub and starts its thread, which reads each frame
+/// from the pump once and publishes a read-only copy of it to every consumer.
+/// Each published frame is reference counted, and its storage is reused once
+/// every consumer has released it, so the fastest consumer may run up to
+/// `FH_DEPTH` frames ahead of the slowest. Once started, the pump is owned by
+/// the hub thread and must not be used by the caller until the hub is freed.
+/// The caller is responsible for freeing the hub with `FH_free`.
+/// @param pump frame pump to read frames from, which must outlive the hub
+/// @param frameSize size of each frame returned by the pump
+/// @param consumers number of consumers reading every frame
+/// @param hub pointer to store the initialized frame hub in
+/// @return 0 on success, a negative error code on failure
+int FH_init(struct frame_pump_s* pump,
+            uint32_t frameSize,
+            int consumers,
+            struct frame_hub_s** hub);
+
+/// @brief Releases the consumer's previous frame and returns a borrowed,
+/// read-only view of its next frame, waiting for the hub thread to publish it
+/// if needed. The view is shared with the other consumers and remains valid
+/// until the consumer's next call to `FH_next`. This may be called from any
+/// thread, but each consumer must only be read by a single thread at a time.
+/// @param hub hub to read from
+/// @param consumer index of the consumer, less than the hub's consumer count
+/// @param fd frame data pointer to return the next frame in
+/// @param repeat pointer to return whether the frame is identical to the
+/// frame before it in, see `FP_isRepeat`
+/// @return 0 on success, a negative error code on failure, or 1 if the pump has
+/// reached the end of the sequence or the hub has been stopped
+int FH_next(struct frame_hub_s* hub,
+            int consumer,
+            const uint8_t** fd,
+            bool* repeat);
+
+/// @brief Copies the pump's read timing statistics and the number of frames
+/// held by the pump, as of the most recently published frame. The pump is
+/// owned by the hub thread, so its status is only available through the hub.
+/// @param hub hub to check
+/// @param stats pointer to store the statistics in
+/// @param frames pointer to store the number of frames held by the pump in
+void FH_getStats(struct frame_hub_s* hub,
+                 struct fp_stats_s* stats,
+                 int* frames);
+
+/// @brief Stops the hub thread from publishing any more frames, and wakes any
+/// consumer waiting on a frame, returning the end of the sequence to it and to
+/// every following read. Consumers may still be reading from the hub until
+/// they are stopped themselves, after which the hub is freed with `FH_free`.
+/// @param hub hub to stop, may be NULL
+void FH_stop(struct frame_hub_s* hub);
+
+/// @brief Stops the hub thread once any in-progress frame is read, and frees
+/// the resources associated with the hub. The pump is not freed.
+/// @param hub hub to free, may be NULL
+void FH_free(struct frame_hub_s* hub);
+
+#endif//FPLAYER_HUB_H
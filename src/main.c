@@ -2,6 +2,8 @@
 /// @brief Main program entry point.
 #include <getopt.h>
 #include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,6 +20,7 @@
 #include "audio.h"
 #include "crmap.h"
 #include "player.h"
+#include "pump.h"
 #include "queue.h"
 #include "serial.h"
 #include "std2/errcode.h"
@@ -31,15 +34,28 @@ static void printUsage(void) {
 
            "[Playback]\n"
            "\t-f <file>\t\tFSEQ v2 sequence file path (required)\n"
-           "\t-c <file>\t\tNetwork channel map file path (required)\n"
+           "\t-c <file>\t\tNetwork channel map file path (required, repeat "
+           "for each network)\n"
            "\t-d <device name|stdout>\tDevice name for serial port "
-           "connection\n"
-           "\t-b <baud rate>\t\tSerial port baud rate (defaults to 19200)\n\n"
+           "connection (repeat in -c order)\n"
+           "\t-b <baud rate>\t\tSerial port baud rate (defaults to 19200)\n"
+           "\t-j <count>\t\tCompression blocks decoded concurrently "
+           "(1-8, defaults to 1)\n"
+           "\t-W <frames>\t\tDecode compression blocks this many frames "
+           "at a time (defaults to whole blocks)\n"
+           "\t-m <MiB>\t\tFrame buffer memory budget (defaults to ~3s "
+           "ahead plus a read)\n"
+           "\t-r <MiB>\t\tLoad sequences up to this size fully before "
+           "playback (0 disables, defaults to 64)\n"
+           "\t-p\t\t\tKeep buffered frames packed as changes in memory\n\n"
 
            "[Controls]\n"
            "\t-a <file>\t\tOverride audio with specified filepath\n"
            "\t-w <seconds>\t\tPlayback start delay to allow connection "
-           "setup\n\n"
+           "setup\n"
+           "\t-s <seconds>\t\tStart playback at the given time offset\n"
+           "\t-S <frame>\t\tStart playback at the given frame (overrides "
+           "-s)\n\n"
 
            "[CLI]\n"
            "\t-t <file>\t\tTest load channel map and exit\n"
@@ -57,13 +73,23 @@ static void printSerialEnumPorts(void) {
 }
 
 static struct {
-    char* seqfp;          ///< Sequence file path
-    char* audiofp;        ///< Audio override file path
-    char* cmapfp;         ///< Channel map file path
-    unsigned int waitsec; ///< Playback start delay
-    char* spname;         ///< Serial port device name
-    int spbaud;           ///< Serial port baud rate
-} gOpts; ///< Global program options
+    char* seqfp;             ///< Sequence file path
+    char* audiofp;           ///< Audio override file path
+    unsigned int waitsec;    ///< Playback start delay
+    int spbaud;              ///< Serial port baud rate
+    int lookahead;           ///< Compression blocks decoded concurrently
+    int blockwindow;         ///< Frames decoded per read of a block
+    unsigned int budgetmb;   ///< Frame buffer memory budget in MiB
+    unsigned int residentmb; ///< Largest sequence loaded fully in MiB
+    bool packed;             ///< Hold buffered frames packed in memory
+    unsigned int startsec;   ///< Playback start offset in seconds
+    uint32_t startframe;     ///< Playback start frame
+
+    char* cmapfps[Q_OUTPUT_MAX]; ///< Channel map file path of each network
+    int cmapcount;               ///< Number of entries in \p cmapfps
+    char* spnames[Q_OUTPUT_MAX]; ///< Serial port device name of each network
+    int spcount;                 ///< Number of entries in \p spnames
+} gOpts = {.residentmb = 64}; ///< Global program options
 
 /// @brief Parse command line options and sets global variables for program
 /// execution via `gOpts`.
@@ -74,7 +100,7 @@ static struct {
 /// code, and zero to indicate the program should continue execution
 static int parseOpts(const int argc, char** const argv) {
     int c;
-    while ((c = getopt(argc, argv, ":t:ilhf:c:a:w:d:b:")) != -1) {
+    while ((c = getopt(argc, argv, ":t:ilhf:c:a:w:d:b:j:W:m:r:ps:S:")) != -1) {
         switch (c) {
             case 't': {
                 struct cr_s* cmap = NULL;
@@ -98,7 +124,13 @@ static int parseOpts(const int argc, char** const argv) {
                 if ((gOpts.seqfp = strdup(optarg)) == NULL) return -FP_ENOMEM;
                 break;
             case 'c':
-                if ((gOpts.cmapfp = strdup(optarg)) == NULL) return -FP_ENOMEM;
+                if (gOpts.cmapcount == Q_OUTPUT_MAX) {
+                    fprintf(stderr, "too many channel maps (max %d)\n",
+                            Q_OUTPUT_MAX);
+                    return -FP_EINVLARG;
+                }
+                if ((gOpts.cmapfps[gOpts.cmapcount++] = strdup(optarg)) == NULL)
+                    return -FP_ENOMEM;
                 break;
             case 'a':
                 if ((gOpts.audiofp = strdup(optarg)) == NULL) return -FP_ENOMEM;
@@ -111,8 +143,30 @@ static int parseOpts(const int argc, char** const argv) {
                     return -FP_EINVLARG;
                 }
                 break;
+            case 's':
+                if (strtolb(optarg, 0, UINT_MAX, &gOpts.startsec,
+                            sizeof(gOpts.startsec))) {
+                    fprintf(stderr, "error parsing `%s` as an integer\n",
+                            optarg);
+                    return -FP_EINVLARG;
+                }
+                break;
+            case 'S':
+                if (strtolb(optarg, 0, INT32_MAX, &gOpts.startframe,
+                            sizeof(gOpts.startframe))) {
+                    fprintf(stderr, "error parsing `%s` as an integer\n",
+                            optarg);
+                    return -FP_EINVLARG;
+                }
+                break;
             case 'd':
-                if ((gOpts.spname = strdup(optarg)) == NULL) return -FP_ENOMEM;
+                if (gOpts.spcount == Q_OUTPUT_MAX) {
+                    fprintf(stderr, "too many serial devices (max %d)\n",
+                            Q_OUTPUT_MAX);
+                    return -FP_EINVLARG;
+                }
+                if ((gOpts.spnames[gOpts.spcount++] = strdup(optarg)) == NULL)
+                    return -FP_ENOMEM;
                 break;
             case 'b':
                 if (strtolb(optarg, 0, UINT_MAX, &gOpts.spbaud,
@@ -122,6 +176,48 @@ static int parseOpts(const int argc, char** const argv) {
                     return -FP_EINVLARG;
                 }
                 break;
+            case 'j':
+                if (strtolb(optarg, 1, FP_LOOKAHEAD_MAX, &gOpts.lookahead,
+                            sizeof(gOpts.lookahead))) {
+                    fprintf(stderr, "error parsing `%s` as an integer (1-%d)\n",
+                            optarg, FP_LOOKAHEAD_MAX);
+                    return -FP_EINVLARG;
+                }
+                break;
+            case 'W':
+                if (strtolb(optarg, 1, INT_MAX, &gOpts.blockwindow,
+                            sizeof(gOpts.blockwindow))) {
+                    fprintf(stderr, "error parsing `%s` as an integer\n",
+                            optarg);
+                    return -FP_EINVLARG;
+                }
+                break;
+            case 'm': {
+                // limit to a budget whose size in bytes fits in a size_t
+                const long max = SIZE_MAX >> 20 < UINT_MAX ? SIZE_MAX >> 20
+                                                            : UINT_MAX;
+                if (strtolb(optarg, 1, max, &gOpts.budgetmb,
+                            sizeof(gOpts.budgetmb))) {
+                    fprintf(stderr, "error parsing `%s` as an integer\n",
+                            optarg);
+                    return -FP_EINVLARG;
+                }
+                break;
+            }
+            case 'r': {
+                const long max = SIZE_MAX >> 20 < UINT_MAX ? SIZE_MAX >> 20
+                                                            : UINT_MAX;
+                if (strtolb(optarg, 0, max, &gOpts.residentmb,
+                            sizeof(gOpts.residentmb))) {
+                    fprintf(stderr, "error parsing `%s` as an integer\n",
+                            optarg);
+                    return -FP_EINVLARG;
+                }
+                break;
+            }
+            case 'p':
+                gOpts.packed = true;
+                break;
             case ':':
                 fprintf(stderr, "option is missing argument: %c\n", optopt);
                 return -FP_EINVLARG;
@@ -132,11 +228,18 @@ static int parseOpts(const int argc, char** const argv) {
         }
     }
 
-    if (gOpts.seqfp == NULL || gOpts.cmapfp == NULL) {
+    if (gOpts.seqfp == NULL || gOpts.cmapcount == 0) {
         printUsage();
         return 1;
     }
 
+    // each serial device is paired with the channel map given in the same
+    // position, networks without a device are silenced
+    if (gOpts.spcount > gOpts.cmapcount) {
+        fprintf(stderr, "more serial devices than channel maps given\n");
+        return -FP_EINVLARG;
+    }
+
     return FP_EOK;
 }
 
@@ -144,13 +247,14 @@ static int parseOpts(const int argc, char** const argv) {
 static void freeOpts(void) {
     free(gOpts.seqfp);
     free(gOpts.audiofp);
-    free(gOpts.cmapfp);
-    free(gOpts.spname);
+    for (int i = 0; i < gOpts.cmapcount; i++) free(gOpts.cmapfps[i]);
+    for (int i = 0; i < gOpts.spcount; i++) free(gOpts.spnames[i]);
 }
 
 int main(const int argc, char** const argv) {
     struct q_s* pq = NULL;           /* playback queue */
-    struct serialdev_s* sdev = NULL; /* serial device */
+    struct serialdev_s* sdevs[Q_OUTPUT_MAX] = {NULL}; /* serial devices */
+    struct player_s* player = NULL;  /* prepared player of the current entry */
 
     int err;
     if ((err = parseOpts(argc, argv))) {
@@ -160,37 +264,67 @@ int main(const int argc, char** const argv) {
         goto ret;
     }
 
-    // initialize serial port device
+    // initialize the serial port device of each network
     const int br = gOpts.spbaud ? gOpts.spbaud : 19200;
-    if ((err = Serial_init(&sdev, gOpts.spname, br))) {
-        fprintf(stderr,
-                "failed to initialize serial port `%s` at %d baud: %s %d\n",
-                gOpts.spname, br, FP_strerror(err), err);
-        goto ret;
+    for (int i = 0; i < gOpts.cmapcount; i++) {
+        if ((err = Serial_init(&sdevs[i], gOpts.spnames[i], br))) {
+            fprintf(stderr,
+                    "failed to initialize serial port `%s` at %d baud: %s "
+                    "%d\n",
+                    gOpts.spnames[i], br, FP_strerror(err), err);
+            goto ret;
+        }
     }
 
+    struct qentry_s ent = {
+            .seqfp = gOpts.seqfp,
+            .audiofp = gOpts.audiofp,
+            .waitsec = gOpts.waitsec,
+            .lookahead = gOpts.lookahead,
+            .blockwindow = gOpts.blockwindow,
+            .budget = (size_t) gOpts.budgetmb << 20,
+            .resident = (size_t) gOpts.residentmb << 20,
+            .packed = gOpts.packed,
+            .startsec = gOpts.startsec,
+            .startframe = gOpts.startframe,
+            .outputs = gOpts.cmapcount,
+    };
+    for (int i = 0; i < gOpts.cmapcount; i++) ent.cmapfps[i] = gOpts.cmapfps[i];
+
     // initialize a queue with the single requested entry
     // TODO: expose ability to queue multiple/schedule playlist
-    if ((err = Q_init(&pq)) ||
-        (err = Q_append(pq, (struct qentry_s){
-                                    .seqfp = gOpts.seqfp,
-                                    .audiofp = gOpts.audiofp,
-                                    .cmapfp = gOpts.cmapfp,
-                                    .waitsec = gOpts.waitsec,
-                            }))) {
+    if ((err = Q_init(&pq)) || (err = Q_append(pq, ent))) {
         fprintf(stderr, "failed to initialize playback queue: %s %d\n",
                 FP_strerror(err), err);
         goto ret;
     }
 
-    // loop through the queue and execute each entry
-    struct qentry_s req;
-    while (!Q_next(pq, &req)) {
-        printf("playing: %s (channel map: %s)\n", req.seqfp, req.cmapfp);
+    // loop through the queue and execute each entry, each following entry is
+    // prepared in the background while the current entry plays
+    struct qentry_s req, next;
+    if (!Q_next(pq, &req) && (err = Player_prepare(&req, &player))) {
+        fprintf(stderr, "failed to prepare player: %s %d\n", FP_strerror(err),
+                err);
+        goto ret;
+    }
+
+    while (player != NULL) {
+        printf("playing: %s\n", req.seqfp);
+        for (int i = 0; i < req.outputs; i++)
+            printf("channel map: %s (device: %s)\n", req.cmapfps[i],
+                   i < gOpts.spcount ? gOpts.spnames[i] : "none");
 
         if (req.audiofp != NULL) printf("audio override: %s\n", req.audiofp);
 
-        if ((err = Player_exec(&req, sdev))) {
+        const bool more = !Q_next(pq, &next);
+
+        struct player_s* prepared = NULL;
+        err = Player_exec(player, more ? &next : NULL, sdevs, &prepared);
+
+        Player_free(player);
+        player = prepared, req = next;
+
+        if (err) {
             fprintf(stderr, "failed to execute player: %s %d\n",
                     FP_strerror(err), err);
             goto ret;
@@ -199,8 +333,9 @@ int main(const int argc, char** const argv) {
 
 ret:
     // attempt shutdown of controlled systems
+    Player_free(player);
     Q_free(pq);
-    Serial_close(sdev);
+    for (int i = 0; i < Q_OUTPUT_MAX; i++) Serial_close(sdevs[i]);
     Audio_exit();
 
     // free immediately owned resources
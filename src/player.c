@@ -3,6 +3,8 @@
 #include "player.h"
 
 #include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -13,7 +15,10 @@
 #include "audio.h"
 #include "cell.h"
 #include "crmap.h"
+#include "encoder.h"
+#include "fseq/fd.h"
 #include "fseq/seq.h"
+#include "hub.h"
 #include "pump.h"
 #include "putil.h"
 #include "queue.h"
@@ -22,57 +27,223 @@
 #include "std2/errcode.h"
 #include "std2/fc.h"
 
+/// @struct player_out_s
+/// @brief Output of the sequence through a single channel map, to its own
+/// serial device.
+struct player_out_s {
+    struct cr_s* cmap;       ///< Channel map file data
+    struct ctable_s* ctable; ///< Computed+cached channel map lookup table
+    struct encoder_s* enc;   ///< Encoder of frame data ahead of playback
+    uint32_t written;        ///< Network bytes written in the last second
+    uint32_t misses;         ///< Frames not encoded by their tick
+};
+
 /// @struct player_rtd_s
 /// @brief Player runtime data structure.
 struct player_rtd_s {
     uint32_t nextFrame;         ///< Index of the next frame to be played
-    struct tf_header_t* seq;    ///< Decoded sequence file metadata header
+    struct seq_s* seq;          ///< Opened sequence file metadata
     struct frame_pump_s* pump;  ///< Frame pump for reading/queueing frame data
+    struct frame_hub_s* hub;    ///< Hub sharing the pump between outputs
     struct sleep_coll_s* scoll; ///< Sleep collector for frame rate control
-    struct ctable_s* ctable;    ///< Computed+cached channel map lookup table
-    uint32_t written;           ///< Network bytes written in the last second
+    struct fd_range_s* ranges;  ///< Frame indexes kept by the pump
+    int rangeCount;             ///< Number of entries in \p ranges
+    int outCount;               ///< Number of entries in \p outs
+    struct player_out_s outs[Q_OUTPUT_MAX]; ///< Output of each channel map
+};
+
+/// @def PLAYER_RANGE_GAP
+/// @brief Maximum number of unmapped frame indexes merged into a kept range.
+/// Copying a cache line of unused bytes is cheaper than splitting the range.
+#define PLAYER_RANGE_GAP 64
+
+/// @struct player_s
+/// @brief Playback of a single queue entry, prepared ahead of its execution.
+struct player_s {
+    struct qentry_s req;     ///< Playback request, copied
+    struct FC* fc;           ///< Sequence file controller
+    struct player_rtd_s rtd; ///< Player runtime data
+};
+
+/// @struct player_prefetch_s
+/// @brief Background preparation of the queue entry following the entry being
+/// played, started during its final seconds.
+struct player_prefetch_s {
+    const struct qentry_s* req; ///< Entry to prepare, or NULL if none
+    bool started;               ///< True if \p thread has been started
+    pthread_t thread;           ///< Thread executing `Player_prepare`
+    struct player_s* player;    ///< Prepared player, once \p thread exits
+    int err;                    ///< Result of the preparation
 };
 
+/// @def PLAYER_PREFETCH_SEC
+/// @brief Seconds before the end of a sequence at which the next queue entry
+/// begins to be prepared in the background.
+#define PLAYER_PREFETCH_SEC 10
+
 /// @brief Frees dynamic allocated structures referenced by the player runtime data.
 /// `rtd` itself is not freed by this function.
 /// @param rtd player runtime data to free
-static void Player_free(struct player_rtd_s* rtd) {
+static void Player_freeRtd(struct player_rtd_s* rtd) {
     assert(rtd != NULL);
 
-    free(rtd->seq);
+    // stop the encoders first, their threads use the hub or pump and their
+    // cell tables, the hub is stopped before them as they may be waiting on it
+    FH_stop(rtd->hub);
+    for (int i = 0; i < rtd->outCount; i++) EN_free(rtd->outs[i].enc);
+    FH_free(rtd->hub);
+
+    // the pump's workers may still be reading the sequence until it is freed
     FP_free(rtd->pump);
+    Seq_free(rtd->seq);
     free(rtd->scoll);
-    CT_free(rtd->ctable);
+    free(rtd->ranges);
+
+    for (int i = 0; i < rtd->outCount; i++) {
+        CT_free(rtd->outs[i].ctable);
+        CMap_free(rtd->outs[i].cmap);
+    }
+}
+
+/// @brief Adds the given frame index ranges to the ranges kept by the pump,
+/// keeping them in ascending order and merging any ranges that overlap or are
+/// separated by no more than `PLAYER_RANGE_GAP` indexes.
+/// @param rtd player runtime data to add the ranges to
+/// @param ranges ascending, non-overlapping ranges to add
+/// @param count number of entries in `ranges`
+/// @return 0 on success, a negative error code on failure
+static int Player_addRanges(struct player_rtd_s* rtd,
+                            const struct fd_range_s* ranges,
+                            const int count) {
+    assert(rtd != NULL);
+    assert(ranges != NULL || count == 0);
+
+    if (count == 0) return FP_EOK;
+
+    struct fd_range_s* merged;
+    if ((merged = malloc((rtd->rangeCount + count) *
+                         sizeof(struct fd_range_s))) == NULL)
+        return -FP_ENOMEM;
+
+    int n = 0;
+    for (int i = 0, j = 0; i < rtd->rangeCount || j < count;) {
+        const struct fd_range_s* r =
+                j == count || (i < rtd->rangeCount &&
+                               rtd->ranges[i].first <= ranges[j].first)
+                        ? &rtd->ranges[i++]
+                        : &ranges[j++];
+
+        struct fd_range_s* last = n > 0 ? &merged[n - 1] : NULL;
+        if (last != NULL &&
+            r->first <= last->first + last->count + PLAYER_RANGE_GAP) {
+            if (r->first + r->count > last->first + last->count)
+                last->count = r->first + r->count - last->first;
+        } else {
+            merged[n++] = *r;
+        }
+    }
+
+    free(rtd->ranges);
+    rtd->ranges = merged;
+    rtd->rangeCount = n;
+
+    return FP_EOK;
 }
 
 /// @brief Populates the player runtime data with dynamically allocated
-/// structures before initializing each subsystem.
+/// structures before initializing each subsystem. Each output's channel map
+/// must already be loaded. The caller is responsible for freeing the runtime
+/// data with `Player_freeRtd`, including on failure.
 /// @param fc sequence file controller to read from
-/// @param cmap channel map to use for index lookups
+/// @param req playback request to configure the subsystems with
 /// @param rtd player runtime data to populate
 /// @return 0 on success, a negative error code on failure
-static int
-Player_init(struct FC* fc, struct cr_s* cmap, struct player_rtd_s* rtd) {
+static int Player_init(struct FC* fc,
+                       const struct qentry_s* req,
+                       struct player_rtd_s* rtd) {
     assert(fc != NULL);
-    assert(cmap != NULL);
+    assert(req != NULL);
     assert(rtd != NULL);
     assert(rtd->seq != NULL);
+    assert(rtd->outCount > 0);
 
     int err;
 
     // initialize the sleep collector for frame rate control
-    if ((err = Sleep_init(&rtd->scoll))) goto ret;
-
-    // initialize the channel map lookup table
-    if ((err = CT_init(cmap, rtd->seq->channelCount, &rtd->ctable))) goto ret;
+    if ((err = Sleep_init(&rtd->scoll))) return err;
+
+    // intensities sent at the same LOR output level are interchangeable
+    uint8_t levels[256];
+    PU_intensityLevels(levels);
+
+    const struct seq_s* seq = rtd->seq;
+    for (int i = 0; i < rtd->outCount; i++) {
+        struct player_out_s* out = &rtd->outs[i];
+
+        // initialize the channel map lookup table
+        if ((err = CT_init(out->cmap, seq->header.channelCount, seq->ranges,
+                           seq->header.channelRangeCount, &out->ctable)))
+            return err;
+
+        CT_setLevels(out->ctable, levels);
+
+        // only the mapped frame indexes are ever output, the pump skips the
+        // indexes not mapped by any output
+        struct fd_range_s* ranges = NULL;
+        int rangeCount = 0;
+        if ((err = CT_ranges(out->ctable, PLAYER_RANGE_GAP, &ranges,
+                             &rangeCount)))
+            return err;
+
+        err = Player_addRanges(rtd, ranges, rangeCount);
+        free(ranges);
+        if (err) return err;
+    }
 
     // initialize the frame pump for reading/queueing frame data
-    if ((err = FP_init(fc, rtd->seq, &rtd->pump))) goto ret;
+    const struct fp_opts_s opts = {
+            .lookahead = req->lookahead,
+            .blockWindow = req->blockwindow,
+            .budget = req->budget,
+            .resident = req->resident,
+            .packed = req->packed,
+            .startFrame = rtd->nextFrame,
+            .ranges = rtd->ranges,
+            .rangeCount = rtd->rangeCount,
+    };
+    if ((err = FP_init(fc, rtd->seq, &opts, &rtd->pump))) return err;
+
+    // multiple outputs share a single read and decode of the sequence, each
+    // frame is published once to the encoder of every output
+    if (rtd->outCount > 1) {
+        uint32_t frameSize = seq->header.channelCount;
+        if (rtd->rangeCount > 0) {
+            frameSize = 0;
+            for (int i = 0; i < rtd->rangeCount; i++)
+                frameSize += rtd->ranges[i].count;
+        }
+
+        if ((err = FH_init(rtd->pump, frameSize, rtd->outCount, &rtd->hub)))
+            return err;
+    }
 
-ret:
-    if (err) Player_free(rtd);
+    // begin reading and encoding the first frames so they are ready once
+    // playback begins, each output's cell table ignores the kept indexes it
+    // does not map
+    for (int i = 0; i < rtd->outCount; i++) {
+        struct player_out_s* out = &rtd->outs[i];
+
+        const struct en_source_s src = {
+                .pump = rtd->hub == NULL ? rtd->pump : NULL,
+                .hub = rtd->hub,
+                .consumer = i,
+        };
+        if ((err = EN_init(&src, rtd->nextFrame, out->ctable, rtd->ranges,
+                           rtd->rangeCount, &out->enc)))
+            return err;
+    }
 
-    return err;
+    return FP_EOK;
 }
 
 /// @brief Prints a log message summarizing the player's current state.
@@ -83,89 +254,185 @@ static void Player_log(struct player_rtd_s* rtd) {
     const double ms = (double) Sleep_average(rtd->scoll) / 1e6;
     const double fps = ms > 0 ? 1000 / ms : 0;
 
-    const long seconds = PU_secondsRemaining(rtd->nextFrame, rtd->seq);
-    const int frames = FP_framesRemaining(rtd->pump);
+    const long seconds =
+            PU_secondsRemaining(rtd->nextFrame, &rtd->seq->header);
 
-    const double kbps = rtd->written / 1024.0;
-    rtd->written = 0;
+    // most recent and slowest read/decode durations reported by the pump, and
+    // the slowest encode duration of each output
+    struct en_stats_s stats;
+    EN_getStats(rtd->outs[0].enc, &stats);
+    const int frames = stats.pumpFrames;
+    const double loadMs = (double) stats.pump.lastNs / 1e6;
+    const double maxMs = (double) stats.pump.maxNs / 1e6;
 
     printf("remaining: %02ldm %02lds\tdt: %.4fms (%.2f fps)\tpump: "
-           "%5d\t\tkbps: "
-           "%.2f\n",
-           seconds / 60, seconds % 60, ms, fps, frames, kbps);
+           "%5d (load: %.2fms/%d, max: %.2fms)",
+           seconds / 60, seconds % 60, ms, fps, frames, loadMs,
+           stats.pump.lastFrames, maxMs);
+
+    for (int i = 0; i < rtd->outCount; i++) {
+        struct player_out_s* out = &rtd->outs[i];
+
+        if (i > 0) EN_getStats(out->enc, &stats);
+        const double encMs = (double) stats.maxNs / 1e6;
+
+        const double kbps = out->written / 1024.0;
+        out->written = 0;
+
+        if (rtd->outCount > 1) printf("\t[%d]", i);
+        printf("\tenc: %d (max: %.2fms, late: %u)\tmiss: %u\tkbps: %.2f",
+               stats.ready, encMs, stats.late, out->misses, kbps);
+    }
+
+    printf("\n");
 }
 
-/// @brief Increments the current frame index and writes the minified frame data
-/// to the serial output. This function drives the core functionality of the player.
-/// @param rtd player runtime data to write the next frame from
+/// @brief Writes the minified frame data of the given frame to the output's
+/// serial device. The frame data has already been applied to the cell table
+/// and encoded ahead of time by the output's encoder thread, so only the
+/// encoded bytes are written at each tick. If the frame has not been encoded
+/// by its tick, the previous frame's output is held and the miss is recorded,
+/// rather than delaying this and every following tick. The frame's changes are
+/// output with a following frame once the encoder catches up. This function
+/// drives the core functionality of the player.
+/// @param out output to write the frame from
+/// @param frame index of the frame to write
 /// @param sdev serial device to write the frame data to
 /// @return 0 on success, a negative error code on failure
-static int Player_writeFrame(struct player_rtd_s* rtd,
+static int Player_writeFrame(struct player_out_s* out,
+                             const uint32_t frame,
                              struct serialdev_s* sdev) {
-    assert(rtd != NULL);
-    assert(rtd->nextFrame < rtd->seq->frameCount);
+    assert(out != NULL);
     assert(sdev != NULL);
 
-    const uint32_t frameSize = rtd->seq->channelCount;
-    const uint32_t frameId = rtd->nextFrame++;
+    const uint8_t* b = NULL; /* borrowed encoded frame view */
+    uint32_t size = 0;
+
+    // a frame not encoded by its tick keeps the previous output on the wire
+    int err;
+    if ((err = EN_next(out->enc, frame, &b, &size)) == EN_MISSED) {
+        out->misses++;
+        return FP_EOK;
+    }
+    if (err) return err;
+
+    if (size > 0) Serial_write(sdev, b, size);
+    out->written += size;
 
-    uint8_t* frameData = NULL; /* frame data buffer */
+    return FP_EOK;
+}
 
-    int err = FP_EOK;
+/// @brief Thread entry point preparing the prefetched queue entry.
+/// @param pargs prefetch state to populate
+/// @return NULL
+static void* Player_prefetchThread(void* pargs) {
+    assert(pargs != NULL);
 
-    if ((err = FP_checkPreload(rtd->pump, frameId))) goto ret;
-    if ((err = FP_nextFrame(rtd->pump, &frameData))) goto ret;
+    struct player_prefetch_s* pf = pargs;
+    pf->err = Player_prepare(pf->req, &pf->player);
 
-    // update the cell table with latest frame data
-    for (uint32_t i = 0; i < frameSize; i++)
-        CT_change(rtd->ctable, i, frameData[i]);
+    return NULL;
+}
+
+/// @brief Starts preparing the prefetched queue entry in the background, if
+/// there is one and it has not already been started. If the thread cannot be
+/// started, the entry is instead prepared once playback completes.
+/// @param pf prefetch state to start
+static void Player_startPrefetch(struct player_prefetch_s* pf) {
+    assert(pf != NULL);
+
+    if (pf->req == NULL || pf->started) return;
 
-    // write the effect data for each matching channel group
-    for (uint32_t i = 0; i < rtd->seq->channelCount; i++) {
-        struct ctgroup_s group;
-        if (!CT_groupof(rtd->ctable, i, &group)) continue;
-        if ((err = PU_writeEffect(sdev, &group, &rtd->written))) goto ret;
+    if (pthread_create(&pf->thread, NULL, Player_prefetchThread, pf)) {
+        fprintf(stderr, "failed to start preparing next sequence\n");
+        pf->req = NULL;
+        return;
     }
 
-    // wait for serial to drain outbound
-    // this creates back pressure that results in fps loss if the serial can't keep up
-    Serial_drain(sdev);
+    pf->started = true;
+}
 
-ret:
-    free(frameData);
+/// @brief Waits for the prefetched queue entry to finish preparing, preparing
+/// it immediately if it was not started in the background.
+/// @param pf prefetch state to finish
+/// @param keep if false, the prepared player is freed rather than returned
+/// @param player out pointer to the prepared player, or NULL if there was no
+/// entry to prepare or it is not kept
+/// @return 0 on success, a negative error code on failure
+static int Player_endPrefetch(struct player_prefetch_s* pf,
+                              const bool keep,
+                              struct player_s** player) {
+    assert(pf != NULL);
+    assert(player != NULL);
+
+    *player = NULL;
+
+    if (pf->started)
+        pthread_join(pf->thread, NULL);
+    else if (keep && pf->req != NULL)
+        pf->err = Player_prepare(pf->req, &pf->player);
+
+    if (!keep || pf->err) {
+        Player_free(pf->player);
+        return pf->err;
+    }
 
-    return err;
+    *player = pf->player;
+
+    return FP_EOK;
 }
 
 /// @brief Main loop of the player that drives the playback of the sequence.
 /// This function will block until the sequence is complete, writing frame data
-/// to the serial output and logging the player's current state. A heartbeat
-/// message is sent every ~500ms to ensure the connection is maintained.
+/// to the serial output of each output and logging the player's current
+/// state. A heartbeat message is sent every ~500ms to ensure the connection is
+/// maintained. The next queue entry begins preparing in the background during
+/// the final seconds of the sequence.
 /// @param rtd initialized player runtime data
-/// @param sdev serial device to write frame data to
+/// @param sdevs serial device of each output to write frame data to
+/// @param pf prefetch state of the next queue entry
 /// @return 0 on success, a negative error code on failure
-static int Player_loop(struct player_rtd_s* rtd, struct serialdev_s* sdev) {
+static int Player_loop(struct player_rtd_s* rtd,
+                       struct serialdev_s* const* sdevs,
+                       struct player_prefetch_s* pf) {
     assert(rtd != NULL);
-    assert(sdev != NULL);
+    assert(sdevs != NULL);
+    assert(pf != NULL);
+
+    const struct tf_header_t* seq = &rtd->seq->header;
 
     int err;
 
-    while (rtd->nextFrame < rtd->seq->frameCount) {
-        Sleep_do(rtd->scoll, rtd->seq->frameStepTimeMillis);
+    while (rtd->nextFrame < seq->frameCount) {
+        Sleep_do(rtd->scoll, seq->frameStepTimeMillis);
 
         // send heartbeat every ~500ms, or sooner if the fps doesn't divide evenly
-        if (rtd->nextFrame % (500 / rtd->seq->frameStepTimeMillis) == 0)
-            if ((err = PU_writeHeartbeat(sdev))) return err;
+        const bool heartbeat =
+                rtd->nextFrame % (500 / seq->frameStepTimeMillis) == 0;
+
+        const uint32_t frame = rtd->nextFrame++;
 
-        if ((err = Player_writeFrame(rtd, sdev))) return err;
+        for (int i = 0; i < rtd->outCount; i++) {
+            if (heartbeat && (err = PU_writeHeartbeat(sdevs[i]))) return err;
+            if ((err = Player_writeFrame(&rtd->outs[i], frame, sdevs[i])))
+                return err;
+        }
+
+        // wait for serial to drain outbound, once every output is written
+        // this creates back pressure that results in fps loss if the serial can't keep up
+        for (int i = 0; i < rtd->outCount; i++) Serial_drain(sdevs[i]);
 
         // only print every second (using the current frame rate as a timer)
-        if (!((rtd->nextFrame - 1) % (1000 / rtd->seq->frameStepTimeMillis)))
+        if (!((rtd->nextFrame - 1) % (1000 / seq->frameStepTimeMillis)))
             Player_log(rtd);
+
+        if (PU_secondsRemaining(rtd->nextFrame, seq) <= PLAYER_PREFETCH_SEC)
+            Player_startPrefetch(pf);
     }
 
     printf("turning off lights, waiting for end of audio...\n");
-    if ((err = PU_lightsOff(sdev))) return err;
+    for (int i = 0; i < rtd->outCount; i++)
+        if ((err = PU_lightsOff(sdevs[i]))) return err;
 
     // continue blocking until audio is finished
     // playback will continue until sequence and audio are both complete
@@ -177,49 +444,109 @@ static int Player_loop(struct player_rtd_s* rtd, struct serialdev_s* sdev) {
     return FP_EOK;
 }
 
-int Player_exec(struct qentry_s* req, struct serialdev_s* sdev) {
+int Player_prepare(const struct qentry_s* req, struct player_s** player) {
     assert(req != NULL);
-    assert(sdev != NULL);
+    assert(req->outputs > 0 && req->outputs <= Q_OUTPUT_MAX);
+    assert(player != NULL);
+
+    *player = NULL;
+
+    struct player_s* p;
+    if ((p = calloc(1, sizeof(struct player_s))) == NULL) return -FP_ENOMEM;
 
-    struct FC* fc = NULL;          /* sequence file controller */
-    struct cr_s* cmap = NULL;      /* channel map file data */
-    struct player_rtd_s rtd = {0}; /* player runtime data */
+    p->req = *req;
+
+    struct player_rtd_s* rtd = &p->rtd;
 
     int err = FP_EOK;
 
     // open the sequence file
-    if ((fc = FC_open(req->seqfp, FC_MODE_READ)) == NULL) {
+    if ((p->fc = FC_open(req->seqfp, FC_MODE_READ)) == NULL) {
         err = -FP_ESYSCALL;
         goto ret;
     }
 
-    // open the channel map file
-    if ((err = CMap_read(req->cmapfp, &cmap))) {
-        fprintf(stderr, "failed to read/parse channel map file `%s`: %s %d\n",
-                req->cmapfp, FP_strerror(err), err);
-        goto ret;
+    // open the channel map file of each output
+    rtd->outCount = req->outputs;
+    for (int i = 0; i < rtd->outCount; i++) {
+        if ((err = CMap_read(req->cmapfps[i], &rtd->outs[i].cmap))) {
+            fprintf(stderr,
+                    "failed to read/parse channel map file `%s`: %s %d\n",
+                    req->cmapfps[i], FP_strerror(err), err);
+            goto ret;
+        }
     }
 
     // open, read and configure environment for the sequence provided
-    if ((err = Seq_open(fc, &rtd.seq))) goto ret;
+    if ((err = Seq_open(p->fc, &rtd->seq))) goto ret;
+
+    // resolve the requested start offset to the first frame to play
+    const uint64_t start =
+            req->startframe ? req->startframe
+                            : (uint64_t) req->startsec * 1000 /
+                                      rtd->seq->header.frameStepTimeMillis;
+    if (start > 0 && start >= rtd->seq->header.frameCount) {
+        fprintf(stderr, "start offset is beyond end of sequence (%u frames)\n",
+                rtd->seq->header.frameCount);
+        err = -FP_ERANGE;
+        goto ret;
+    }
+
+    rtd->nextFrame = (uint32_t) start;
+    if (start > 0) printf("starting at frame: %u\n", rtd->nextFrame);
 
     // initialize runtime data for the player
-    if ((err = Player_init(fc, cmap, &rtd))) goto ret;
+    if ((err = Player_init(p->fc, req, rtd))) goto ret;
+
+    // load audio if available, it is started once playback begins
+    // TODO: print err for audio, but ignore
+    if ((err = PU_loadFirstAudio(req->audiofp, p->fc, &rtd->seq->header,
+                                 rtd->nextFrame)))
+        goto ret;
+
+ret:
+    if (err)
+        Player_free(p);
+    else
+        *player = p;
+
+    return err;
+}
+
+int Player_exec(struct player_s* player,
+                const struct qentry_s* next,
+                struct serialdev_s* const* sdevs,
+                struct player_s** prepared) {
+    assert(player != NULL);
+    assert(sdevs != NULL);
+    assert(prepared != NULL);
+
+    struct player_prefetch_s pf = {.req = next};
+
+    int err, perr;
 
     // sleep/wait for connection if requested
-    if ((err = PU_wait(sdev, req->waitsec))) goto ret;
+    if ((err = PU_wait(sdevs, player->rtd.outCount, player->req.waitsec)))
+        goto ret;
 
-    // play audio if available
-    // TODO: print err for audio, but ignore
-    if ((err = PU_playFirstAudio(req->audiofp, fc, rtd.seq))) goto ret;
+    // play the audio loaded when the player was prepared, if any
+    if ((err = Audio_start())) goto ret;
 
     // begin the main loop of the player
-    if ((err = Player_loop(&rtd, sdev))) goto ret;
+    if ((err = Player_loop(&player->rtd, sdevs, &pf))) goto ret;
 
 ret:
-    Player_free(&rtd);
-    CMap_free(cmap);
-    FC_close(fc);
+    // always wait for a background preparation, which is discarded if
+    // playback failed
+    perr = Player_endPrefetch(&pf, err == FP_EOK, prepared);
 
-    return err;
+    return err ? err : perr;
+}
+
+void Player_free(struct player_s* player) {
+    if (player == NULL) return;
+
+    Player_freeRtd(&player->rtd);
+    FC_close(player->fc);
+    free(player);
 }
@@ -7,13 +7,43 @@ struct qentry_s;
 
 struct serialdev_s;
 
-/// @brief Initializes and starts playback of the given playback configuration.
-/// Execution will block until the sequence is complete, including audio
-/// playback; unless an error occurs. The caller is responsible for freeing the
-/// resources provided in the playback request.
-/// @param req play request to execute
-/// @param sdev serial device to use for playback
+/// @struct player_s
+/// @brief Playback of a single queue entry, prepared ahead of its execution.
+struct player_s;
+
+/// @brief Prepares playback of the given playback configuration without
+/// starting it. This opens the sequence file and the channel map of each
+/// output, builds their cell tables, initializes the frame pump and begins
+/// reading the first frames, and loads the audio. Outputs share a single frame
+/// pump, whose frames are read and decoded once and published to each output.
+/// This may be called from any thread. The caller is responsible for freeing
+/// the player with `Player_free`, and for keeping the strings referenced by
+/// the playback request valid until then.
+/// @param req play request to prepare
+/// @param player out pointer to the prepared player
 /// @return 0 on success, a negative error code on failure
-int Player_exec(struct qentry_s* req, struct serialdev_s* sdev);
+int Player_prepare(const struct qentry_s* req, struct player_s** player);
+
+/// @brief Starts playback of the given prepared player. Execution will block
+/// until the sequence is complete, including audio playback; unless an error
+/// occurs. If a following playback configuration is given, it is prepared in
+/// the background during the final seconds of playback, allowing playback to
+/// hand off to it without delay.
+/// @param player prepared player to execute
+/// @param next play request to prepare once playback nears its end, or NULL
+/// @param sdevs serial device of each output, in the order of the request's
+/// channel maps
+/// @param prepared out pointer to the player prepared for `next`, or NULL if
+/// there is no next request or an error occurred
+/// @return 0 on success, a negative error code on failure to play, or to
+/// prepare the next request
+int Player_exec(struct player_s* player,
+                const struct qentry_s* next,
+                struct serialdev_s* const* sdevs,
+                struct player_s** prepared);
+
+/// @brief Frees the player and all resources held by it.
+/// @param player player to free
+void Player_free(struct player_s* player);
 
 #endif//FPLAYER_PLAYER_H
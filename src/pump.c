@@ -3,6 +3,7 @@
 #include "pump.h"
 
 #include <assert.h>
+#include <limits.h>
 #include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -13,113 +14,977 @@
 
 #include "fseq/comblock.h"
 #include "fseq/fd.h"
+#include "fseq/seq.h"
 #include "std2/errcode.h"
 #include "std2/fc.h"
+#include "std2/time.h"
+
+/// @struct fp_pos_s
+/// @brief Read position of a frame set within the sequence.
+struct fp_pos_s {
+    uint32_t frame; ///< Frame index, relative to block \p cb if compressed
+    int cb;         ///< Compression block index, used by compressed sequences
+};
+
+/// @enum fp_job_state_t
+/// @brief Lifecycle state of a preload request.
+enum fp_job_state_t {
+    FP_JOB_QUEUED, ///< Waiting to be picked up by a worker
+    FP_JOB_BUSY,   ///< Being read by a worker
+    FP_JOB_DONE,   ///< Read completed, awaiting collection by the pump
+};
+
+/// @struct fp_job_s
+/// @brief Preload request for reading a frame set into a reserved range of
+/// ring slots. Request fields are written by the pump before queueing, result
+/// fields are written by a worker while busy.
+struct fp_job_s {
+    enum fp_job_state_t state;  ///< Lifecycle state, guarded by the pump lock
+    struct fp_pos_s pos;        ///< Read position of the frame set
+    int start;                  ///< Slot index of the first frame to write
+    int room;                   ///< Number of ring slots reserved
+    int frames;                 ///< Number of frames written by the read
+    int err;                    ///< Result of the read
+    int64_t ns;                 ///< Duration of the read in nanoseconds
+    struct fd_pack_s* pack;     ///< Set the read packs frames into, if packed
+    struct comblock_dec_s* dec; ///< Block stream continued by the read, or NULL
+};
+
+/// @def FP_JOB_MAX
+/// @brief Maximum number of preload requests outstanding at once, and the
+/// number of worker threads that may be started to execute them.
+#define FP_JOB_MAX FP_LOOKAHEAD_MAX
 
 struct frame_pump_s {
     struct FC* fc;                 ///< File controller to read from
     const struct tf_header_t* seq; ///< Sequence file metadata header
-    struct fd_list_s curr;         ///< Current frame set to read from
-    struct fd_list_s next;         ///< Preloaded frame set to read from next
-    bool preloading;               ///< Preloading/preloaded state flag
-    pthread_t thread;              ///< Preload thread
-    union {
-        uint32_t frame; ///< Target frame index
-        int cb;         ///< Target compression block index
-    } pos;              ///< Read position data
+    const struct comblock_s* blocks; ///< Sequence compression block index
+    struct fd_ring_s ring;         ///< Decoded frames awaiting playback
+    bool* repeats;                 ///< Per slot, frame matches the one before
+    int cap;                       ///< Frames held at once, read or reserved
+    bool packed;                   ///< Frames are held packed, not in \p ring
+    struct fd_pack_s* packs;       ///< Packed frame sets, oldest first
+    struct fd_pack_s* packsTail;   ///< Most recently published packed set
+    struct fd_pack_s* spare;       ///< Played packed sets kept for reuse
+    int held;                      ///< Packed frames awaiting playback
+    uint8_t* frames[2];            ///< Last expanded frame, and the one before
+    struct fd_range_s* ranges;     ///< Frame bytes kept, or NULL for all
+    int rangeCount;                ///< Number of entries in \p ranges
+    uint32_t frameSize;            ///< Size of a kept frame in bytes
+    uint8_t* proj;                 ///< Projected copy of the mapped frame
+    const uint8_t* map;            ///< Mapped file for zero-copy playback
+    const uint8_t* prev;           ///< Previously played full mapped frame
+    bool played;                   ///< A frame has been returned by the pump
+    bool repeat;                   ///< Returned frame repeats the previous
+    uint32_t mapFrames;            ///< Number of frames covered by \p map
+    uint32_t advised;              ///< Frame index read-ahead is hinted up to
+    bool resident;                 ///< Whole sequence has been read
+    int window;                    ///< Maximum frames produced by one read
+    int reqd;                      ///< Frame count that triggers a preload
+    int lookahead;                 ///< Maximum number of outstanding requests
+    int reserved;                  ///< Ring slots reserved by requests
+    int span;                      ///< Slots needed by the read at \p pos
+    struct fp_pos_s pos;           ///< Next read position to request
+    struct fp_stats_s stats;       ///< Read timing reported by the workers
+    struct comblock_dec_s dec;     ///< Decoder state for synchronous reads
+    bool stream;                   ///< Blocks are decoded a window at a time
+    struct comblock_dec_s streams[FP_JOB_MAX]; ///< Decoder of each block
+    int workers;                   ///< Number of worker threads started
+    bool quit;                     ///< Requests the worker threads to exit
+    pthread_t threads[FP_JOB_MAX]; ///< Long-lived preload worker threads
+    pthread_mutex_t lock;          ///< Guards job states and \p quit
+    pthread_cond_t wake;           ///< Signals the workers of new requests
+    pthread_cond_t done;           ///< Signals the pump of completed requests
+    struct fp_job_s jobs[FP_JOB_MAX]; ///< Queue of preload requests
+    int jobHead;                      ///< Index of the oldest request
+    int jobCount;                     ///< Number of outstanding requests
 };
 
+/// @brief Attempts to memory map the pump's file controller for zero-copy
+/// playback of uncompressed frame data. Frames are limited to those fully
+/// contained within the file, in case the file is truncated.
+/// @param pump frame pump to configure
+/// @return true if the file was mapped and the pump should use it, otherwise
+/// false to indicate the pump should fall back to reading into its ring
+static bool FP_initMap(struct frame_pump_s* pump) {
+    assert(pump != NULL);
+
+    const struct tf_header_t* seq = pump->seq;
+
+    // mappings may exceed 4 GiB, so offsets into them are computed in size_t
+    size_t size;
+    if ((pump->map = FC_map(pump->fc, &size)) == NULL) return false;
+    if (size < seq->channelDataOffset) return pump->map = NULL, false;
+
+    const size_t frames = (size - seq->channelDataOffset) / seq->channelCount;
+    pump->mapFrames =
+            frames < seq->frameCount ? (uint32_t) frames : seq->frameCount;
+
+    FC_advise(pump->fc, seq->channelDataOffset,
+              (size_t) pump->mapFrames * seq->channelCount,
+              FC_ADVICE_SEQUENTIAL);
+
+    return true;
+}
+
+static void* FP_thread(void* pargs);
+
+/// @brief Requests the pump's worker threads to exit once any in-progress read
+/// completes, and waits for them to do so.
+/// @param pump frame pump to stop the workers of
+static void FP_stopWorkers(struct frame_pump_s* pump) {
+    assert(pump != NULL);
+
+    pthread_mutex_lock(&pump->lock);
+    pump->quit = true;
+    pthread_cond_broadcast(&pump->wake);
+    pthread_mutex_unlock(&pump->lock);
+
+    for (; pump->workers > 0; pump->workers--)
+        pthread_join(pump->threads[pump->workers - 1], NULL);
+}
+
+/// @brief Stops the pump's worker threads if they were started, and destroys
+/// the synchronization primitives used to hand requests to them.
+/// @param pump frame pump to free the workers of
+static void FP_freeWorkers(struct frame_pump_s* pump) {
+    assert(pump != NULL);
+
+    if (pump->workers == 0) return;
+
+    FP_stopWorkers(pump);
+
+    pthread_cond_destroy(&pump->done);
+    pthread_cond_destroy(&pump->wake);
+    pthread_mutex_destroy(&pump->lock);
+}
+
+/// @brief Starts a long-lived preload worker thread for each request the pump
+/// may have outstanding, and the synchronization primitives used to hand
+/// requests to them.
+/// @param pump frame pump to start the workers for
+/// @return 0 on success, a negative error code on failure
+static int FP_startWorkers(struct frame_pump_s* pump) {
+    assert(pump != NULL);
+
+    if (pthread_mutex_init(&pump->lock, NULL)) return -FP_EPTHREAD;
+
+    if (pthread_cond_init(&pump->wake, NULL)) goto err_wake;
+    if (pthread_cond_init(&pump->done, NULL)) goto err_done;
+
+    for (; pump->workers < pump->lookahead; pump->workers++)
+        if (pthread_create(&pump->threads[pump->workers], NULL, FP_thread,
+                           pump))
+            goto err_thread;
+
+    return FP_EOK;
+
+err_thread:
+    FP_stopWorkers(pump);
+    pthread_cond_destroy(&pump->done);
+err_done:
+    pthread_cond_destroy(&pump->wake);
+err_wake:
+    pthread_mutex_destroy(&pump->lock);
+
+    return -FP_EPTHREAD;
+}
+
+/// @brief Configures the pump to keep only the given byte ranges of each frame.
+/// The ranges are validated and copied, and the kept frame size is updated to
+/// their total size.
+/// @param pump frame pump to configure
+/// @param ranges ranges to keep, in ascending order
+/// @param count number of ranges
+/// @return 0 on success, a negative error code on failure, or -FP_ERANGE if the
+/// ranges are empty, unordered, overlapping or beyond the end of a frame
+static int FP_initRanges(struct frame_pump_s* pump,
+                         const struct fd_range_s* ranges,
+                         const int count) {
+    assert(pump != NULL);
+    assert(ranges != NULL);
+
+    if (count <= 0) return -FP_ERANGE;
+
+    const uint32_t frameSize = pump->seq->channelCount;
+
+    uint32_t end = 0, size = 0;
+    for (int i = 0; i < count; i++) {
+        const struct fd_range_s* r = &ranges[i];
+        if (r->count == 0 || r->first < end || r->first >= frameSize ||
+            r->count > frameSize - r->first)
+            return -FP_ERANGE;
+        end = r->first + r->count, size += r->count;
+    }
+
+    if ((pump->ranges = malloc(sizeof(*ranges) * count)) == NULL)
+        return -FP_ENOMEM;
+    memcpy(pump->ranges, ranges, sizeof(*ranges) * count);
+
+    pump->rangeCount = count;
+    pump->frameSize = size;
+
+    // decoders project each frame as it is decompressed
+    pump->dec.ranges = pump->ranges;
+    pump->dec.rangeCount = count;
+
+    return FP_EOK;
+}
+
+/// @brief Positions the pump to begin playback at the given frame. Compressed
+/// sequences begin reading at the block containing the frame, found by binary
+/// search of the block index, and the decoder discards the frames preceding it
+/// in that block without writing them to frame storage.
+/// @param pump frame pump to position
+/// @param frame index of the first frame to play
+static void FP_seek(struct frame_pump_s* pump, const uint32_t frame) {
+    assert(pump != NULL);
+    assert(frame < pump->seq->frameCount);
+
+    if (pump->seq->compressionType != TF_COMPRESSION_ZSTD) {
+        pump->pos.frame = frame;
+        return;
+    }
+
+    // find the last block starting at or before the frame, since the final
+    // block spans to the end of the sequence this always contains the frame
+    int lo = 0, hi = pump->seq->compressionBlockCount;
+    while (hi - lo > 1) {
+        const int mid = lo + (hi - lo) / 2;
+        if (pump->blocks[mid].firstFrame <= frame)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    pump->pos.cb = lo;
+    if (lo < pump->seq->compressionBlockCount &&
+        pump->blocks[lo].firstFrame < frame)
+        pump->pos.frame = frame - pump->blocks[lo].firstFrame;
+}
+
+/// @brief Returns the number of frames held by the pump awaiting playback.
+/// @param pump frame pump to check
+/// @return number of frames held
+static int FP_held(const struct frame_pump_s* pump) {
+    assert(pump != NULL);
+    return pump->packed ? pump->held : pump->ring.count;
+}
+
+/// @brief Returns the number of frames that may be read into the pump before
+/// it reaches its capacity, including those reserved by outstanding requests.
+/// @param pump frame pump to check
+/// @return number of frames
+static int FP_space(const struct frame_pump_s* pump) {
+    assert(pump != NULL);
+    return pump->cap - FP_held(pump);
+}
+
+/// @brief Adapts the low-water mark and read window of an uncompressed pump to
+/// its measured read throughput and ring capacity. The low-water mark covers
+/// twice the time a full read is expected to take, and no less than a second
+/// of playback, so a read started at the mark completes well before the ring
+/// runs dry. The remaining ring capacity is used as the read window. Until a
+/// read has been measured, the initial low-water mark is kept. Compressed
+/// pumps are unaffected, as their reads are fixed to the block window.
+/// @param pump frame pump to tune
+static void FP_tune(struct frame_pump_s* pump) {
+    assert(pump != NULL);
+
+    const struct tf_header_t* seq = pump->seq;
+    if (seq->compressionType != TF_COMPRESSION_NONE) return;
+
+    const struct fp_stats_s* stats = &pump->stats;
+
+    int reqd = pump->reqd;
+    if (stats->totalFrames > 0) {
+        const double stepNs = seq->frameStepTimeMillis * 1e6;
+        const double frameNs =
+                (double) stats->totalNs / (double) stats->totalFrames;
+
+        reqd = (int) (2 * frameNs * pump->window / stepNs) + 1;
+
+        const int second = 1000 / seq->frameStepTimeMillis;
+        if (reqd < second) reqd = second;
+    }
+
+    // always leave at least half of the ring available to reads
+    const int cap = pump->cap;
+    if (reqd > cap / 2) reqd = cap / 2;
+
+    pump->reqd = reqd;
+    pump->window = cap - reqd;
+}
+
+static int FP_load(struct frame_pump_s* pump);
+
 int FP_init(struct FC* fc,
-            const struct tf_header_t* seq,
+            const struct seq_s* sequence,
+            const struct fp_opts_s* opts,
             struct frame_pump_s** pump) {
     assert(fc != NULL);
-    assert(seq != NULL);
+    assert(sequence != NULL);
     assert(pump != NULL);
-    if ((*pump = calloc(1, sizeof(struct frame_pump_s))) == NULL)
+
+    const struct tf_header_t* seq = &sequence->header;
+
+    // require at least N seconds of frames to be available for playback, until
+    // the read throughput has been measured
+    const int reqd = (1000 / seq->frameStepTimeMillis) * 3;
+
+    // a single read produces either a full compression block, or a window of
+    // it if configured, or 10 seconds of frame data at a time when reading
+    // uncompressed data
+    int window = 0;
+    switch (seq->compressionType) {
+        case TF_COMPRESSION_ZSTD:
+            for (int i = 0; i < seq->compressionBlockCount; i++)
+                if (sequence->blocks[i].frames > (uint32_t) window)
+                    window = (int) sequence->blocks[i].frames;
+            if (opts != NULL && opts->blockWindow > 0 &&
+                opts->blockWindow < window)
+                window = opts->blockWindow;
+            break;
+        case TF_COMPRESSION_NONE:
+            window = 10000 / seq->frameStepTimeMillis;
+            break;
+        default:
+            return -FP_ERANGE;
+    }
+
+    struct frame_pump_s* p;
+    if ((p = calloc(1, sizeof(struct frame_pump_s))) == NULL)
         return -FP_ENOMEM;
-    (*pump)->fc = fc;
-    (*pump)->seq = seq;
+
+    p->fc = fc;
+    p->seq = seq;
+    p->blocks = sequence->blocks;
+    p->frameSize = seq->channelCount;
+    p->window = window;
+    p->reqd = reqd;
+
+    int err;
+
+    if (opts != NULL && opts->startFrame > 0) {
+        if (opts->startFrame >= seq->frameCount) {
+            err = -FP_ERANGE;
+            goto err_pump;
+        }
+
+        FP_seek(p, opts->startFrame);
+    }
+
+    if (opts != NULL && opts->ranges != NULL &&
+        (err = FP_initRanges(p, opts->ranges, opts->rangeCount)))
+        goto err_pump;
+
+    // compression blocks are decoded independently, allowing several to be
+    // read ahead concurrently, uncompressed reads remain sequential
+    p->lookahead = opts != NULL && opts->lookahead > 0 ? opts->lookahead : 1;
+    if (p->lookahead > FP_JOB_MAX) p->lookahead = FP_JOB_MAX;
+    if (seq->compressionType != TF_COMPRESSION_ZSTD) p->lookahead = 1;
+
+    // windows of a block are decoded in order by a decoder kept positioned
+    // within the block, reading its compressed data in bounded chunks
+    p->stream = seq->compressionType == TF_COMPRESSION_ZSTD && opts != NULL &&
+                opts->blockWindow > 0;
+    p->dec.stream = p->stream;
+    for (int i = 0; i < FP_JOB_MAX; i++)
+        p->streams[i] = (struct comblock_dec_s){
+                .stream = true,
+                .ranges = p->dec.ranges,
+                .rangeCount = p->dec.rangeCount,
+        };
+
+    // sequences whose frames all fit within the resident limit are read in
+    // full ahead of playback, so playback never waits on the file or decoder
+    const uint32_t stride = FD_stride(p->frameSize);
+    const bool resident = opts != NULL && seq->frameCount < INT_MAX &&
+                          seq->frameCount + 1 <= opts->resident / stride;
+
+    // uncompressed frame data can otherwise be played directly from a file
+    // mapping, requiring neither frame storage nor a preload thread, projected
+    // frames are gathered into a single copy as they are played
+    if (!resident && seq->compressionType == TF_COMPRESSION_NONE &&
+        FP_initMap(p)) {
+        if (p->ranges != NULL && (p->proj = malloc(p->frameSize)) == NULL) {
+            err = -FP_ENOMEM;
+            goto err_pump;
+        }
+
+        *pump = p;
+        return FP_EOK;
+    }
+
+    int cap;
+    if (resident) {
+        cap = (int) seq->frameCount;
+    } else if (opts != NULL && opts->budget > 0) {
+        // hold as many frames as fit within the budget, including the extra
+        // slot held back by the ring for the frame currently being played
+        const size_t frames = opts->budget / stride;
+        cap = frames > INT_MAX ? INT_MAX : (int) frames - 1;
+
+        // a compression block (window) is always decoded in full, while
+        // uncompressed reads can be split down to a single frame
+        const int min =
+                seq->compressionType == TF_COMPRESSION_ZSTD && window > 2
+                        ? window
+                        : 2;
+        if (cap < min) {
+            fprintf(stderr,
+                    "frame pump memory budget is too small, exceeding it to "
+                    "hold %d frames\n",
+                    min);
+            cap = min;
+        }
+
+        // uncompressed reads are shrunk to fit the budget instead
+        if (seq->compressionType == TF_COMPRESSION_NONE && window > cap)
+            p->window = window = cap;
+
+        // limit the blocks decoded concurrently to those fitting the budget,
+        // always leaving a worker to read ahead of playback
+        if (window > 0 && cap / window < p->lookahead)
+            p->lookahead = cap / window > 0 ? cap / window : 1;
+    } else {
+        // size the ring to hold the low-water frames plus a full read for
+        // each outstanding request, with an extra slot held back by the ring
+        // for the frame currently being played
+        cap = reqd + window * p->lookahead;
+    }
+
+    // sequences shorter than that are held in full instead
+    if ((uint32_t) cap > seq->frameCount) cap = (int) seq->frameCount;
+    if (cap < 1) cap = 1;
+
+    p->cap = cap;
+
+    // packed frames are held in sets sized to their content rather than the
+    // ring, and expanded into a single frame as they are played
+    p->packed = opts != NULL && opts->packed;
+    if (p->packed) {
+        if ((p->frames[0] = calloc(1, p->frameSize)) == NULL ||
+            (p->frames[1] = calloc(1, p->frameSize)) == NULL) {
+            err = -FP_ENOMEM;
+            goto err_ring;
+        }
+    } else {
+        if ((err = FD_init(&p->ring, p->frameSize, cap + 1))) goto err_pump;
+
+        if ((p->repeats = calloc(cap + 1, sizeof(bool))) == NULL) {
+            err = -FP_ENOMEM;
+            goto err_ring;
+        }
+    }
+
+    if ((err = FP_startWorkers(p))) goto err_ring;
+
+    // frame data is read front to back, allowing the page cache to read ahead
+    size_t size = (size_t) seq->frameCount * seq->channelCount;
+    if (seq->compressionType == TF_COMPRESSION_ZSTD &&
+        seq->compressionBlockCount > 0) {
+        const struct comblock_s* last =
+                &p->blocks[seq->compressionBlockCount - 1];
+        size = last->addr + last->size - seq->channelDataOffset;
+    }
+    FC_advise(fc, seq->channelDataOffset, size, FC_ADVICE_SEQUENTIAL);
+
+    FP_tune(p);
+
+    if (resident && (err = FP_load(p))) {
+        FP_free(p);
+        return err;
+    }
+
+    *pump = p;
+
     return FP_EOK;
+
+err_ring:
+    free(p->frames[0]);
+    free(p->frames[1]);
+    free(p->repeats);
+    FD_free(&p->ring);
+err_pump:
+    free(p->ranges);
+    free(p);
+
+    return err;
 }
 
-/// @brief Reads the next frame set from the file controller and stores it in the
-/// provided frame data node pointer. This function is used when the sequence is
-/// not compressed and read sequentially from the file controller.
+/// @def FP_IOV_MAX
+/// @brief Maximum number of frames scattered into ring slots by a single
+/// vectored read.
+#define FP_IOV_MAX 64
+
+/// @brief Reads the next frame set from the file controller directly into the
+/// given ring slots. This function is used when the sequence is not compressed
+/// and read sequentially from the file controller. If ranges are given, only
+/// those bytes of each frame are read, and stored consecutively in its slot.
+/// If a pack is given, frames are appended to it rather than the ring.
 /// @param fc file controller to read from
 /// @param seq sequence header for playback configuration
+/// @param ranges frame bytes to read, or NULL to read full frames
+/// @param rangeCount number of entries in `ranges`
 /// @param frame frame index to read
-/// @param list frame data list pointer to store the next frame set in
-/// @return 0 on success, a negative error code on failure, or `FP_ESEQEND` if
-/// the pump has reached the end of the sequence
+/// @param ring frame ring to read into
+/// @param pack frame set to pack into, or NULL to read into the ring
+/// @param start slot index of the first frame to write
+/// @param room maximum number of frames to read
+/// @param frames out pointer to the number of frames read
+/// @return 0 on success, a negative error code on failure, or 1 if the pump
+/// has reached the end of the sequence
 static int FP_readSeq(struct FC* fc,
                       const struct tf_header_t* seq,
+                      const struct fd_range_s* ranges,
+                      const int rangeCount,
                       const uint32_t frame,
-                      struct fd_list_s* list) {
+                      struct fd_ring_s* ring,
+                      struct fd_pack_s* pack,
+                      const int start,
+                      const int room,
+                      int* const frames) {
     assert(fc != NULL);
     assert(seq != NULL);
-    assert(list != NULL);
+    assert(ring != NULL);
+    assert(frames != NULL);
+
+    const uint32_t frameSize = seq->channelCount;
+
+    int n = 0;
+    int total = room; /* frames to read, limited to the end of the sequence */
+    if ((uint32_t) total > seq->frameCount - frame)
+        total = (int) (seq->frameCount - frame);
 
-    // attempt to read 10 seconds of frame data at a time
-    const int frames = 10000 / seq->frameStepTimeMillis;
-    const uint32_t pos = seq->channelDataOffset + (frame * seq->channelCount);
+    // each slot is padded to a cache line, so consecutive frames are scattered
+    // into their slots by vectored reads rather than a single contiguous read
+    while (ranges == NULL && pack == NULL && n < total) {
+        struct fc_iov_s iov[FP_IOV_MAX];
 
-    // allocate a single block for the full frame set
-    uint8_t* b = calloc(frames, seq->channelCount);
-    if (b == NULL) return -FP_ENOMEM;
+        int k = 0;
+        for (; k < FP_IOV_MAX && n + k < total; k++)
+            iov[k] = (struct fc_iov_s){.b = FD_slot(ring, start + n + k),
+                                       .size = frameSize};
 
-    const uint32_t read = FC_readto(fc, pos, seq->channelCount, frames, b);
+        const uint32_t pos = seq->channelDataOffset + (frame + n) * frameSize;
+        const uint32_t r = FC_readv(fc, pos, iov, k);
 
-    if (read == 0) {// EOF
-        free(b);
-        return 1; /* end of sequence */
+        n += (int) (r / frameSize);
+        if (r < k * frameSize) break;// EOF or truncated frame
     }
 
+    // projected frames read each range individually, skipping the unkept
+    // bytes between them entirely, packed frames are read one at a time
+    const bool single = ranges != NULL || pack != NULL;
+    const struct fd_range_s all = {.first = 0, .count = frameSize};
+    const struct fd_range_s* rs = ranges != NULL ? ranges : &all;
+    const int rc = ranges != NULL ? rangeCount : 1;
+
     int err = FP_EOK;
 
-    // copy into frame data linked list
-    // TODO: this is a slow operation given the memory is *already* structured
-    for (uint32_t i = 0; i < read; i++) {
-        uint8_t* fd;
-        if ((fd = malloc(seq->channelCount)) == NULL) {
-            err = -FP_ENOMEM;
-            goto ret;
-        }
+    for (; single && n < total; n++) {
+        const uint32_t pos = seq->channelDataOffset + (frame + n) * frameSize;
 
-        memcpy(fd, &b[i * seq->channelCount], seq->channelCount);
+        uint8_t* slot = pack ? FD_packSlot(pack) : FD_slot(ring, start + n);
+
+        int r = 0;
+        for (; r < rc; r++) {
+            const struct fd_range_s* range = &rs[r];
+            if (FC_read(fc, pos + range->first, range->count, slot) <
+                range->count)
+                break;
+            slot += range->count;
+        }
+        if (r < rc) break;// EOF or truncated frame
 
-        if ((err = FD_append(list, fd)) < 0) goto ret;
+        if (pack != NULL && (err = FD_pack(pack))) break;
     }
 
-ret:
-    if (err) FD_free(list);
-    free(b);
+    *frames = n;
 
-    return err;
+    if (err) return err;
+    return n == 0 ? 1 /* end of sequence */ : FP_EOK;
+}
+
+/// @brief Tags each of the given frames written to the ring with whether it is
+/// identical to the frame in the slot before it, allowing playback to skip the
+/// work of frames that repeat the previous one. The comparison is left to
+/// `memcmp`, which the C library vectorizes.
+/// @param pump frame pump to tag the frames of
+/// @param first slot index of the first frame to tag, the slot preceding it
+/// must hold a frame
+/// @param n number of frames to tag
+static void FP_tag(struct frame_pump_s* pump, const int first, const int n) {
+    assert(pump != NULL);
+    assert(first >= 0);
+
+    const struct fd_ring_s* ring = &pump->ring;
+    for (int i = first; i < first + n; i++)
+        pump->repeats[i % ring->cap] =
+                memcmp(FD_slot(ring, i), FD_slot(ring, i + ring->cap - 1),
+                       ring->frameSize) == 0;
 }
 
-/// @brief Reads the next frame set from the file controller and stores it in the
-/// provided frame data node pointer. The pump should have its `pos` union
-/// updated with read request position information before calling this function.
+/// @brief Executes the given preload request, reading its frame set from the
+/// file controller directly into the request's reserved ring slots, or its
+/// packed set. The frames are not published until the request is collected.
+/// The duration of the read is recorded in the request.
 /// @param pump frame pump to read from
-/// @param list frame data list pointer to store the next frame set in
-/// @return 0 on success, a negative error code on failure, or `FP_ESEQEND` if
-/// the pump has reached the end of the sequence
-static int FP_read(struct frame_pump_s* pump, struct fd_list_s* list) {
+/// @param job preload request to execute
+/// @param dec decoder state owned by the calling thread, used unless the
+/// request continues the stream of its block
+static void FP_run(struct frame_pump_s* pump,
+                   struct fp_job_s* job,
+                   struct comblock_dec_s* dec) {
     assert(pump != NULL);
-    assert(list != NULL);
+    assert(job != NULL);
+    assert(dec != NULL);
+
+    const timeInstant start = timeGetNow();
+
+    job->frames = 0;
+
+    if (job->dec != NULL) dec = job->dec;
+
+    // a failed read is retried from the start of its set
+    if (job->pack != NULL) FD_resetPack(job->pack);
+    dec->pack = job->pack;
 
     switch (pump->seq->compressionType) {
         case TF_COMPRESSION_ZSTD:
-            if (pump->pos.cb >= pump->seq->compressionBlockCount)
-                return 1; /* end of sequence */
-            return ComBlock_read(pump->fc, pump->seq, pump->pos.cb, list);
+            job->err = ComBlock_read(dec, pump->fc, pump->seq,
+                                     &pump->blocks[job->pos.cb], job->pos.frame,
+                                     &pump->ring, job->start, job->room,
+                                     &job->frames);
+            break;
         case TF_COMPRESSION_NONE:
-            if (pump->pos.frame >= pump->seq->frameCount)
-                return 1; /* end of sequence */
-            return FP_readSeq(pump->fc, pump->seq, pump->pos.frame, list);
+            job->err = FP_readSeq(pump->fc, pump->seq, pump->ranges,
+                                  pump->rangeCount, job->pos.frame,
+                                  &pump->ring, job->pack, job->start,
+                                  job->room, &job->frames);
+            break;
         default:
-            return -FP_ERANGE;
+            job->err = -FP_ERANGE;
+            break;
     }
+
+    // each frame after the first is compared while the worker still has the
+    // set's frames in cache, the first is compared once the previous set has
+    // been published, packed frames are compared as they are expanded
+    if (job->pack == NULL && job->frames > 1)
+        FP_tag(pump, job->start + 1, job->frames - 1);
+
+    job->ns = timeElapsedNs(start, timeGetNow());
+}
+
+/// @brief Determines the number of ring slots required by the next read at the
+/// pump's read position. Compressed reads reserve the exact frame span of the
+/// remainder of their block, up to the block window, so that blocks decoded
+/// concurrently each write to their own slots. Blocks spanning no frames are
+/// skipped. The result is cached until the read position advances.
+/// @param pump frame pump to check
+/// @return number of slots required, 0 if the pump has reached the end of the
+/// sequence, or a negative error code on failure
+static int FP_nextSpan(struct frame_pump_s* pump) {
+    assert(pump != NULL);
+
+    const struct tf_header_t* seq = pump->seq;
+
+    while (pump->span == 0) {
+        switch (seq->compressionType) {
+            case TF_COMPRESSION_ZSTD: {
+                if (pump->pos.cb >= seq->compressionBlockCount) return 0;
+                const uint32_t left =
+                        pump->blocks[pump->pos.cb].frames - pump->pos.frame;
+                pump->span = (uint32_t) pump->window < left ? pump->window
+                                                            : (int) left;
+                if (pump->span == 0) pump->pos.cb++, pump->pos.frame = 0;
+                break;
+            }
+            case TF_COMPRESSION_NONE: {
+                if (pump->pos.frame >= seq->frameCount) return 0;
+                const uint32_t left = seq->frameCount - pump->pos.frame;
+                pump->span = (uint32_t) pump->window < left ? pump->window
+                                                            : (int) left;
+                break;
+            }
+            default:
+                return -FP_ERANGE;
+        }
+    }
+
+    return pump->span;
+}
+
+/// @brief Provides an empty packed frame set, reusing a played set if one is
+/// available.
+/// @param pump packed frame pump to provide a set for
+/// @param pack out pointer to the set
+/// @return 0 on success, a negative error code on failure
+static int FP_takePack(struct frame_pump_s* pump, struct fd_pack_s** pack) {
+    assert(pump != NULL);
+    assert(pack != NULL);
+
+    if ((*pack = pump->spare) != NULL) {
+        pump->spare = (*pack)->next;
+        return FP_EOK;
+    }
+
+    if ((*pack = malloc(sizeof(struct fd_pack_s))) == NULL) return -FP_ENOMEM;
+
+    int err;
+    if ((err = FD_initPack(*pack, pump->frameSize))) {
+        free(*pack), *pack = NULL;
+        return err;
+    }
+
+    return FP_EOK;
+}
+
+/// @brief Returns a packed frame set that is no longer needed to the pump for
+/// reuse by a following request.
+/// @param pump packed frame pump to return the set to
+/// @param pack set to return
+static void FP_releasePack(struct frame_pump_s* pump, struct fd_pack_s* pack) {
+    assert(pump != NULL);
+    assert(pack != NULL);
+
+    pack->next = pump->spare;
+    pump->spare = pack;
+}
+
+/// @brief Frees each packed frame set of the given list.
+/// @param pack first set of the list, may be NULL
+static void FP_freePacks(struct fd_pack_s* pack) {
+    while (pack != NULL) {
+        struct fd_pack_s* next = pack->next;
+        FD_freePack(pack);
+        free(pack);
+        pack = next;
+    }
+}
+
+/// @brief Expands the next frame of the oldest packed frame set into the
+/// pump's frame buffer, releasing the set once all of its frames have been
+/// expanded.
+/// @param pump packed frame pump to expand the next frame of
+/// @return true if the frame differs from the previously expanded frame, false
+/// if it is identical
+static bool FP_unpack(struct frame_pump_s* pump) {
+    assert(pump != NULL);
+    assert(pump->held > 0);
+
+    struct fd_pack_s* pack = pump->packs;
+
+    // the first frame of each set is packed against a blank frame rather than
+    // the last frame of the previous set, so it is expanded into the other
+    // buffer and compared to the previous frame directly
+    bool changed;
+    if (pack->read == 0) {
+        uint8_t* prev = pump->frames[0];
+        pump->frames[0] = pump->frames[1], pump->frames[1] = prev;
+        FD_unpack(pack, pump->frames[0]);
+        changed = memcmp(pump->frames[0], prev, pump->frameSize) != 0;
+    } else {
+        changed = FD_unpack(pack, pump->frames[0]);
+    }
+
+    pump->held--;
+
+    if (pack->read == pack->count) {
+        if ((pump->packs = pack->next) == NULL) pump->packsTail = NULL;
+        FP_releasePack(pump, pack);
+    }
+
+    return changed;
+}
+
+/// @brief Prepares a preload request for the next frame set at the pump's read
+/// position, reserving the free ring slots following the frames already
+/// available or requested. The pump's read position is advanced past the
+/// requested frame set. The caller must ensure the ring has enough unreserved
+/// space for the frame set using `FP_nextSpan`. Packed pumps provide the
+/// request with a set to pack its frames into, and streaming pumps with the
+/// decoder of its block.
+/// @param pump frame pump to prepare the request for
+/// @param job request to populate
+/// @return 0 on success, a negative error code on failure
+static int FP_prepare(struct frame_pump_s* pump, struct fp_job_s* job) {
+    assert(pump != NULL);
+    assert(pump->span > 0);
+    assert(pump->span <= FP_space(pump) - pump->reserved);
+    assert(job != NULL);
+
+    struct fd_pack_s* pack = NULL;
+
+    int err;
+    if (pump->packed && (err = FP_takePack(pump, &pack))) return err;
+
+    *job = (struct fp_job_s){
+            .state = FP_JOB_QUEUED,
+            .pos = pump->pos,
+            .pack = pack,
+    };
+
+    // reserve the slots following any frames requested but not yet collected
+    job->start = FD_tail(&pump->ring) + pump->reserved;
+    job->room = pump->span;
+
+    pump->reserved += job->room;
+    pump->span = 0;
+
+    pump->pos.frame += job->room;
+
+    if (pump->seq->compressionType != TF_COMPRESSION_ZSTD) return FP_EOK;
+
+    // each window of a block continues the stream left by the window before it
+    if (pump->stream) job->dec = &pump->streams[job->pos.cb % pump->lookahead];
+
+    if (pump->pos.frame < pump->blocks[pump->pos.cb].frames) return FP_EOK;
+
+    pump->pos.cb++, pump->pos.frame = 0;
+
+    // hint the following block so it is paged in while this one is decoded
+    if (pump->pos.cb < pump->seq->compressionBlockCount) {
+        const struct comblock_s* next = &pump->blocks[pump->pos.cb];
+        FC_advise(pump->fc, next->addr, next->size, FC_ADVICE_WILLNEED);
+    }
+
+    return FP_EOK;
+}
+
+/// @brief Publishes the frames read by a completed request to the pump's ring
+/// and records its timing. Failed requests are retried synchronously once,
+/// since their ring slots remain reserved. Packed frame sets are instead
+/// appended to the pump's list of sets.
+/// @param pump frame pump to update
+/// @param job completed request, which must be the oldest outstanding request
+/// @return 0 on success, a negative error code on failure, or 1 if the
+/// request reached the end of the sequence
+static int FP_complete(struct frame_pump_s* pump, struct fp_job_s* job) {
+    assert(pump != NULL);
+    assert(job != NULL);
+
+    pump->reserved -= job->room;
+
+    // the block's stream may already be continued by the following request,
+    // so a failed request is retried with the pump's own decoder instead
+    if (job->err < 0) {
+        job->dec = NULL;
+        FP_run(pump, job, &pump->dec);
+    }
+    if (job->err) goto err_job;
+
+    const bool first = pump->stats.reads == 0; /* no frame precedes the set */
+
+    pump->stats.lastNs = job->ns;
+    pump->stats.lastFrames = job->frames;
+    if (job->ns > pump->stats.maxNs) pump->stats.maxNs = job->ns;
+    pump->stats.totalNs += job->ns;
+    pump->stats.totalFrames += job->frames;
+    pump->stats.reads++;
+
+    // a block decoding fewer frames than its table entry spans would leave a
+    // gap before the slots reserved by the following block, blank the missing
+    // frames so later frames remain aligned with their timestamps
+    if (pump->seq->compressionType == TF_COMPRESSION_ZSTD) {
+        for (; job->frames < job->room; job->frames++) {
+            if (job->pack != NULL) {
+                memset(FD_packSlot(job->pack), 0, pump->frameSize);
+                if ((job->err = FD_pack(job->pack))) goto err_job;
+                continue;
+            }
+            memset(FD_slot(&pump->ring, job->start + job->frames), 0,
+                   pump->ring.frameSize);
+            pump->repeats[(job->start + job->frames) % pump->ring.cap] = false;
+        }
+    }
+
+    if (job->pack != NULL) {
+        struct fd_pack_s* pack = job->pack;
+        if (pump->packsTail != NULL)
+            pump->packsTail->next = pack;
+        else
+            pump->packs = pack;
+        pump->packsTail = pack, pack->next = NULL;
+        pump->held += pack->count;
+
+        FP_tune(pump);
+
+        return FP_EOK;
+    }
+
+    // the frame preceding the set was published by the previous request, and
+    // remains intact even if it has since been played, since the ring holds
+    // back the most recently played slot
+    if (first)
+        pump->repeats[job->start % pump->ring.cap] = false;
+    else if (job->frames > 0)
+        FP_tag(pump, job->start, 1);
+
+    FD_commit(&pump->ring, job->frames);
+
+    FP_tune(pump);
+
+    return FP_EOK;
+
+err_job:
+    // the set is not published, keep it for reuse by a following request
+    if (job->pack != NULL) FP_releasePack(pump, job->pack);
+
+    return job->err;
+}
+
+/// @brief Collects the oldest outstanding preload request from the workers if
+/// it has completed, publishing its frames to the pump's ring. Requests are
+/// always collected in the order they were prepared, regardless of the order
+/// in which the workers complete them.
+/// @param pump frame pump to collect from
+/// @param wait if true, blocks until the oldest request has completed
+/// @return 0 on success or if nothing was collected, a negative error code on
+/// failure, or 1 if the request reached the end of the sequence
+static int FP_collect(struct frame_pump_s* pump, const bool wait) {
+    assert(pump != NULL);
+
+    if (pump->jobCount == 0) return FP_EOK;
+
+    struct fp_job_s* job = &pump->jobs[pump->jobHead];
+
+    pthread_mutex_lock(&pump->lock);
+    while (wait && job->state != FP_JOB_DONE)
+        pthread_cond_wait(&pump->done, &pump->lock);
+    const bool done = job->state == FP_JOB_DONE;
+    if (done) {
+        pump->jobHead = (pump->jobHead + 1) % FP_JOB_MAX;
+        pump->jobCount--;
+    }
+    pthread_mutex_unlock(&pump->lock);
+
+    // the request slot is not reused until the next call to FP_prepare
+    return done ? FP_complete(pump, job) : FP_EOK;
+}
+
+/// @brief Checks if the request at the given position of the pump's queue must
+/// wait for an earlier request continuing the same block stream to complete,
+/// since the windows of a block are decoded in order by a single decoder.
+/// @param pump frame pump owning the queue, with its lock held
+/// @param i position of the request within the queue
+/// @return true if the request may not be executed yet
+static bool FP_waits(const struct frame_pump_s* pump, const int i) {
+    assert(pump != NULL);
+    assert(i >= 0 && i < pump->jobCount);
+
+    const struct fp_job_s* job = &pump->jobs[(pump->jobHead + i) % FP_JOB_MAX];
+    if (job->dec == NULL) return false;
+
+    for (int k = 0; k < i; k++) {
+        const struct fp_job_s* j =
+                &pump->jobs[(pump->jobHead + k) % FP_JOB_MAX];
+        if (j->dec == job->dec && j->state != FP_JOB_DONE) return true;
+    }
+
+    return false;
 }
 
 static void* FP_thread(void* pargs) {
@@ -127,102 +992,270 @@ static void* FP_thread(void* pargs) {
 
     struct frame_pump_s* pump = pargs;
 
-    int err;
-    if ((err = FP_read(pump, &pump->next))) {
-        FD_free(&pump->next);// free list contents
+    // each worker keeps its own decoder state alive across requests
+    struct comblock_dec_s dec = {.ranges = pump->ranges,
+                                 .rangeCount = pump->rangeCount};
+
+    pthread_mutex_lock(&pump->lock);
+
+    while (!pump->quit) {
+        // find the oldest request that has not been picked up yet, and is not
+        // waiting on the previous window of its block
+        struct fp_job_s* job = NULL;
+        for (int i = 0; i < pump->jobCount && job == NULL; i++) {
+            struct fp_job_s* j = &pump->jobs[(pump->jobHead + i) % FP_JOB_MAX];
+            if (j->state == FP_JOB_QUEUED && !FP_waits(pump, i)) job = j;
+        }
 
-        if (err < 0)
+        if (job == NULL) {
+            pthread_cond_wait(&pump->wake, &pump->lock);
+            continue;
+        }
+
+        // the request is owned by the worker while busy, read without the
+        // lock held so the pump and other workers may continue
+        job->state = FP_JOB_BUSY;
+        pthread_mutex_unlock(&pump->lock);
+
+        FP_run(pump, job, &dec);
+
+        if (job->err < 0)
             fprintf(stderr, "failed to preload next frame set: %s %d\n",
-                    FP_strerror(err), err);
+                    FP_strerror(job->err), job->err);
+
+        pthread_mutex_lock(&pump->lock);
+        job->state = FP_JOB_DONE;
+        pthread_cond_signal(&pump->done);
+
+        // the following window of the block may now be decoded
+        if (job->dec != NULL) pthread_cond_broadcast(&pump->wake);
     }
 
+    pthread_mutex_unlock(&pump->lock);
+
+    ComBlock_freeDecoder(&dec);
+
     return NULL;
 }
 
-int FP_checkPreload(struct frame_pump_s* pump, const uint32_t frame) {
+/// @brief Keeps a window of mapped frame data ahead of the playhead hinted as
+/// needed, allowing the operating system to page it in before playback
+/// reaches it rather than faulting on each frame.
+/// @param pump mapped frame pump to check
+static void FP_checkMapAdvice(struct frame_pump_s* pump) {
     assert(pump != NULL);
+    assert(pump->map != NULL);
 
-    if (pump->curr.count == 0) return false; /* empty, will sync read */
-    if (pump->preloading) return false;      /* already busy */
+    if (pump->advised < pump->pos.frame) pump->advised = pump->pos.frame;
+    if (pump->advised >= pump->mapFrames) return;
+    if (pump->advised - pump->pos.frame >= (uint32_t) pump->reqd) return;
 
-    // require at least N seconds of frames to be available for playback
-    const int reqd = (1000 / pump->seq->frameStepTimeMillis) * 3;
-    if (pump->curr.count >= reqd) return FP_EOK;
+    uint32_t frames = pump->mapFrames - pump->advised;
+    if (frames > (uint32_t) pump->window) frames = pump->window;
 
-    pump->preloading = true;
+    const size_t frameSize = pump->seq->channelCount;
+    FC_advise(pump->fc,
+              pump->seq->channelDataOffset + pump->advised * frameSize,
+              frames * frameSize, FC_ADVICE_WILLNEED);
 
-    // customize the preload request given the compression mode of the sequence
-    // if compressed, request the next block (in order)
-    // otherwise, read frame data sequentially starting at the end of the
-    // currently available frame data
-    switch (pump->seq->compressionType) {
-        case TF_COMPRESSION_ZSTD:
-            pump->pos.cb++;
-            break;
-        case TF_COMPRESSION_NONE:
-            pump->pos.frame = frame + reqd;
-            break;
-        default:
-            return -FP_ERANGE;
+    pump->advised += frames;
+}
+
+int FP_checkPreload(struct frame_pump_s* pump) {
+    assert(pump != NULL);
+
+    if (pump->resident) return FP_EOK;
+
+    if (pump->map != NULL) {
+        FP_checkMapAdvice(pump);
+        return FP_EOK;
+    }
+
+    // publish completed preloads as soon as they are available, rather than
+    // waiting for the ring to run empty
+    int err;
+    while (pump->jobCount > 0) {
+        const int count = pump->jobCount;
+        if ((err = FP_collect(pump, false)) < 0) return err;
+        if (pump->jobCount == count) break; /* oldest still in progress */
+    }
+
+    // keep up to `lookahead` requests outstanding, as long as the ring has
+    // unreserved space for them
+    // the ring is sized so the space for a full read only frees up once the
+    // available frames have dropped to the low-water mark
+    while (pump->jobCount < pump->lookahead) {
+        const int span = FP_nextSpan(pump);
+        if (span <= 0) return span; /* end of sequence or error */
+        if (span > FP_space(pump) - pump->reserved) break;
+
+        // workers write directly into the free slots following the currently
+        // available frame data, which playback will not touch until they are
+        // committed once the request is collected
+        struct fp_job_s* job =
+                &pump->jobs[(pump->jobHead + pump->jobCount) % FP_JOB_MAX];
+
+        if ((err = FP_prepare(pump, job))) return err;
+
+        pthread_mutex_lock(&pump->lock);
+        pump->jobCount++;
+        pthread_cond_signal(&pump->wake);
+        pthread_mutex_unlock(&pump->lock);
+    }
+
+    return FP_EOK;
+}
+
+/// @brief Reads the whole sequence into the pump's ring ahead of playback.
+/// Compressed blocks are decoded concurrently by the workers as usual, which
+/// are then stopped along with the pump's decoders being freed, since the pump
+/// has no further reads to perform.
+/// @param pump frame pump to load, with a ring sized to the whole sequence
+/// @return 0 on success, a negative error code on failure
+static int FP_load(struct frame_pump_s* pump) {
+    assert(pump != NULL);
+
+    int err;
+    for (;;) {
+        if ((err = FP_checkPreload(pump)) < 0) return err;
+        if (pump->jobCount == 0) break; /* end of sequence */
+        if ((err = FP_collect(pump, true)) < 0) return err;
     }
 
-    if (pthread_create(&pump->thread, NULL, FP_thread, pump))
-        return -FP_EPTHREAD;
+    FP_freeWorkers(pump);
+    ComBlock_freeDecoder(&pump->dec);
+    for (int i = 0; i < FP_JOB_MAX; i++)
+        ComBlock_freeDecoder(&pump->streams[i]);
+
+    pump->resident = true;
 
     return FP_EOK;
 }
 
-int FP_nextFrame(struct frame_pump_s* pump, uint8_t** fd) {
+/// @brief Checks if the given mapped frame is identical to the previously
+/// played mapped frame, comparing only the kept bytes of each frame.
+/// @param pump mapped frame pump to check
+/// @param frame full mapped frame to compare
+/// @return true if the kept bytes of both frames are identical
+static bool FP_mapRepeats(const struct frame_pump_s* pump,
+                          const uint8_t* frame) {
+    assert(pump != NULL);
+    assert(pump->prev != NULL);
+    assert(frame != NULL);
+
+    if (pump->ranges == NULL)
+        return memcmp(frame, pump->prev, pump->frameSize) == 0;
+
+    for (int r = 0; r < pump->rangeCount; r++) {
+        const struct fd_range_s* range = &pump->ranges[r];
+        if (memcmp(&frame[range->first], &pump->prev[range->first],
+                   range->count) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+int FP_nextFrame(struct frame_pump_s* pump, const uint8_t** fd) {
     assert(pump != NULL);
     assert(fd != NULL);
 
+    // mapped frames are returned in place, or gathered if projected
+    if (pump->map != NULL) {
+        if (pump->pos.frame >= pump->mapFrames) return 1; /* end of sequence */
+        *fd = &pump->map[pump->seq->channelDataOffset +
+                         (size_t) pump->pos.frame * pump->seq->channelCount];
+        pump->repeat = pump->prev != NULL && FP_mapRepeats(pump, *fd);
+        pump->prev = *fd;
+        if (pump->proj != NULL) {
+            FD_project(pump->ranges, pump->rangeCount, *fd, pump->proj);
+            *fd = pump->proj;
+        }
+        pump->pos.frame++;
+        return FP_EOK;
+    }
+
     // pump is empty
-    // check if a preloaded frame set is available for instant consumption,
+    // wait for the oldest outstanding preload to complete if one exists,
     // otherwise block the playback and read the next frame set immediately
-    if (pump->curr.count == 0) {
-        // attempt to pull from a potentially pre-existing preload thread
-        if (pump->preloading) {
-            if (pthread_join(pump->thread, NULL)) return -FP_EPTHREAD;
-            pump->preloading = false;
+    int err;
+    while (FP_held(pump) == 0) {
+        if (pump->jobCount > 0) {
+            if ((err = FP_collect(pump, true))) return err;
+            continue;
         }
 
-        if (pump->next.count == 0) {
-            // immediately read from source if a preload is not available
-            int err;
-            if ((err = FP_read(pump, &pump->next))) {
-                FD_free(&pump->next);
-                return err;
-            }
-        }
+        if ((err = FP_nextSpan(pump)) <= 0) return err ? err : 1;
 
-        // handle the swap to the new frame set
-        if (pump->next.count > 0) {
-            pump->curr = pump->next;
-            memset(&pump->next, 0, sizeof(pump->next));
-        }
+        struct fp_job_s job;
+        if ((err = FP_prepare(pump, &job))) return err;
+
+        FP_run(pump, &job, &pump->dec);
+
+        if ((err = FP_complete(pump, &job))) return err;
     }
 
-    // copy the next frame from the current frame set
-    struct fd_node_s* node = FD_shift(&pump->curr);
-    if (node == NULL) return 1; /* end of sequence */
-    *fd = node->frame, free(node);
+    // packed frames are expanded into the pump's frame as they are played
+    if (pump->packed) {
+        const bool changed = FP_unpack(pump);
+        pump->repeat = pump->played && !changed;
+        pump->played = true;
+        *fd = pump->frames[0];
+        return FP_EOK;
+    }
+
+    // borrow the next frame from the ring, a frame discarded before the first
+    // played frame is not considered to precede it
+    const int head = pump->ring.head;
+    if ((*fd = FD_shift(&pump->ring)) == NULL) return 1; /* end of sequence */
+    pump->repeat = pump->played && pump->repeats[head];
+    pump->played = true;
 
     return FP_EOK;
 }
 
+bool FP_isRepeat(const struct frame_pump_s* pump) {
+    assert(pump != NULL);
+    return pump->repeat;
+}
+
 int FP_framesRemaining(struct frame_pump_s* pump) {
     assert(pump != NULL);
-    return pump->curr.count;
+    if (pump->map != NULL) return (int) (pump->advised - pump->pos.frame);
+    return FP_held(pump);
+}
+
+void FP_getStats(struct frame_pump_s* pump, struct fp_stats_s* stats) {
+    assert(pump != NULL);
+    assert(stats != NULL);
+    *stats = pump->stats;
 }
 
 void FP_free(struct frame_pump_s* pump) {
     if (pump == NULL) return;
 
-    // destroy any lingering preload thread that may have been triggered,
-    // loaded no data, and was therefore not joined via swapping frame sets
-    if (pump->preloading) pthread_detach(pump->thread);
+    // stop the workers once any in-progress reads complete, since they write
+    // directly into the ring
+    FP_freeWorkers(pump);
+
+    // packed sets are held by outstanding requests, published for playback or
+    // kept for reuse
+    for (int i = 0; i < pump->jobCount; i++) {
+        struct fd_pack_s* pack =
+                pump->jobs[(pump->jobHead + i) % FP_JOB_MAX].pack;
+        if (pack != NULL) FP_releasePack(pump, pack);
+    }
+    FP_freePacks(pump->packs);
+    FP_freePacks(pump->spare);
 
-    FD_free(&pump->curr);
-    FD_free(&pump->next);
+    ComBlock_freeDecoder(&pump->dec);
+    for (int i = 0; i < FP_JOB_MAX; i++)
+        ComBlock_freeDecoder(&pump->streams[i]);
+    FD_free(&pump->ring);
+    free(pump->frames[0]);
+    free(pump->frames[1]);
+    free(pump->repeats);
+    free(pump->proj);
+    free(pump->ranges);
     free(pump);
 }
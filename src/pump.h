@@ -3,52 +3,142 @@
 #ifndef FPLAYER_PUMP_H
 #define FPLAYER_PUMP_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 struct FC;
 
-struct tf_header_t;
+struct seq_s;
+
+struct fd_range_s;
 
 /// @struct frame_pump_s
 /// @brief Frame pump state controller for loading/tracking frame data.
 struct frame_pump_s;
 
+/// @def FP_LOOKAHEAD_MAX
+/// @brief Maximum number of compression blocks a pump may decode concurrently.
+#define FP_LOOKAHEAD_MAX 8
+
+/// @struct fp_opts_s
+/// @brief Frame pump configuration options. Zeroed fields select defaults,
+/// which decode a whole block at a time into time based frame storage, keeping
+/// every byte of every frame from the start of the sequence unpacked, and never
+/// hold the whole sequence in memory.
+struct fp_opts_s {
+    int lookahead;                   ///< Blocks decoded concurrently
+    int blockWindow;                 ///< Frames decoded per read of a block
+    size_t budget;                   ///< Frame storage bytes
+    size_t resident;                 ///< Largest whole sequence held, in bytes
+    uint32_t startFrame;             ///< Index of the first frame to play
+    const struct fd_range_s* ranges; ///< Frame bytes to keep, or NULL for all
+    int rangeCount;                  ///< Number of entries in \p ranges
+    bool packed;                     ///< Hold frames packed until played
+};
+
 /// @brief Initializes a frame pump with the provided file controller. The pump
-/// will read frames from the file controller and store them in an internal
-/// buffer for playback. The pump will also preload the next frame set
-/// asynchronously in a separate thread to ensure smooth playback. The caller is
-/// responsible for freeing the pump with `FP_free`.
+/// will read frames from the file controller and store them in a fixed-size
+/// internal ring buffer for playback. The pump will also preload the next frame
+/// sets asynchronously using long-lived worker threads to ensure smooth
+/// playback. Compressed sequences decode up to `lookahead` blocks concurrently,
+/// one per worker, and are delivered to playback in order. If a block window is
+/// given, each block is instead decoded and delivered that many frames at a
+/// time, with the decoder kept positioned within the block between windows,
+/// bounding the delay before a block's first frame is available and the frame
+/// storage reserved for it by the window rather than the block size. Windows of
+/// the same block are decoded in order, so only the windows of different blocks
+/// are decoded concurrently. Frame storage is sized to the memory budget if one
+/// is given, otherwise to a few seconds of playback plus a full read per
+/// worker. The low-water mark and uncompressed read window adapt to the
+/// measured read throughput. Playback may begin at any frame, in which case
+/// compressed sequences begin decoding at the block containing it and discard
+/// the block's leading frames as they are decoded. If byte ranges are given,
+/// only those bytes of each frame are kept, and frames are returned compacted
+/// to the consecutive bytes of each range in order, reducing frame storage to
+/// the channels actually used, and uncompressed reads to only the ranges.
+/// Uncompressed sequences are instead played directly from a memory mapping of
+/// the file when supported, without any intermediate frame storage or preload
+/// thread. Sequences whose frames all fit within the `resident` limit are
+/// instead fully read (and decoded) before this function returns, after which
+/// the workers are stopped and playback never touches the file controller
+/// again. Frame storage may instead be packed, holding each frame as the bytes
+/// changed from the frame before it, see `FD_pack`, in which case frames are
+/// only expanded as they are returned. The caller is responsible for freeing
+/// the pump with `FP_free`.
 /// @param fc file controller to read frames from
-/// @param seq sequence file for file layout information
+/// @param seq opened sequence file for file layout information, which must
+/// outlive the pump
+/// @param opts configuration options, or NULL to use the defaults
 /// @param pump pointer to store the initialized frame pump in
-/// @return 0 on success, a negative error code on failure
+/// @return 0 on success, a negative error code on failure, or -FP_ERANGE if the
+/// start frame is beyond the end of the sequence, or the ranges are empty,
+/// unordered, overlapping or beyond the end of a frame
 int FP_init(struct FC* fc,
-            const struct tf_header_t* seq,
+            const struct seq_s* seq,
+            const struct fp_opts_s* opts,
             struct frame_pump_s** pump);
 
 /// @brief Checks if the pump's internal buffer is low, and if so, preloads the
-/// next frame set from the file controller asynchronously in a separate thread.
-/// The preloaded data is stored within the pump, allowing it to be read once
-/// the pre-existing primary buffer is empty.
+/// next frame sets from the file controller asynchronously using the pump's
+/// worker threads. Any preloads completed by the workers are published first.
+/// The preloaded data is written into the free space of the pump's buffer,
+/// and becomes available for reading once the pre-existing frames are empty.
+/// Memory mapped pumps instead hint the upcoming frame data to be paged in, and
+/// resident pumps do nothing.
 /// @param pump pump to check
-/// @param frame current frame index for aligning read position
 /// @return 0 on success, a negative error code on failure
-int FP_checkPreload(struct frame_pump_s* pump, uint32_t frame);
+int FP_checkPreload(struct frame_pump_s* pump);
 
-/// @brief Copies the next frame of data from the pump to the provided frame
-/// data buffer. If the pump's internal buffer is empty, the pump will attempt
-/// to read more frames from the file controller provided during initialization.
-/// @param pump pump to copy from
-/// @param fd frame data pointer to return the next frame in
+/// @brief Returns a borrowed, read-only view of the next frame of data held by
+/// the pump. The view is owned by the pump and remains valid until the next
+/// call to `FP_checkPreload` or `FP_nextFrame`. Memory mapped views point
+/// directly into the file controller's mapping, unless the pump is configured
+/// to project frames in which case they are copied out of it. Packed frames are
+/// expanded into a single frame owned by the pump. If the pump's internal
+/// buffer is empty, the pump will attempt to read more frames from the file
+/// controller provided during initialization.
+/// @param pump pump to read from
+/// @param fd frame data pointer to return the next frame in, of the sequence's
+/// frame size or the total size of the pump's ranges if configured
 /// @return 0 on success, a negative error code on failure, or 1 if the pump has
 /// reached the end of the sequence
-int FP_nextFrame(struct frame_pump_s* pump, uint8_t** fd);
+int FP_nextFrame(struct frame_pump_s* pump, const uint8_t** fd);
+
+/// @brief Checks if the frame most recently returned by `FP_nextFrame` is
+/// identical to the frame returned before it, in which case the caller may skip
+/// any work derived from the frame's content. Frames read into the pump's
+/// internal buffer are compared as they are read, memory mapped frames are
+/// compared as they are returned. The first frame returned is never a repeat.
+/// @param pump pump to check
+/// @return true if the frame repeats the previous frame
+bool FP_isRepeat(const struct frame_pump_s* pump);
 
 /// @brief Returns the number of frames remaining in the pump's internal buffer.
 /// @param pump pump to check
 /// @return number of frames remaining in the pump's internal buffer
 int FP_framesRemaining(struct frame_pump_s* pump);
 
+/// @struct fp_stats_s
+/// @brief Read and decode timing reported by the pump's preload workers. Each
+/// read produces a full compression block or a window of it, or a window of
+/// uncompressed frames.
+/// Reads are reported in sequence order as they are published to playback.
+struct fp_stats_s {
+    int64_t lastNs;       ///< Duration of the most recent read in nanoseconds
+    int lastFrames;       ///< Number of frames produced by the most recent read
+    int64_t maxNs;        ///< Duration of the slowest read in nanoseconds
+    int64_t totalNs;      ///< Cumulative duration of all reads in nanoseconds
+    uint64_t totalFrames; ///< Cumulative number of frames produced by all reads
+    uint64_t reads;       ///< Number of reads completed
+};
+
+/// @brief Copies the pump's read timing statistics. Memory mapped pumps do not
+/// perform reads and always report zeroed statistics.
+/// @param pump pump to check
+/// @param stats pointer to store the statistics in
+void FP_getStats(struct frame_pump_s* pump, struct fp_stats_s* stats);
+
 /// @brief Frees the resources associated with the provided frame pump.
 /// @param pump pump to free
 void FP_free(struct frame_pump_s* pump);
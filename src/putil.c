@@ -3,6 +3,8 @@
 #include "putil.h"
 
 #include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -21,8 +23,10 @@
     #include <time.h>
 #endif
 
-int PU_wait(struct serialdev_s* sdev, const unsigned int seconds) {
-    assert(sdev != NULL);
+int PU_wait(struct serialdev_s* const* sdevs,
+            const int count,
+            const unsigned int seconds) {
+    assert(sdevs != NULL);
 
     // LOR hardware may require several heartbeat messages are sent
     // before it considers itself connected to the player
@@ -34,7 +38,8 @@ int PU_wait(struct serialdev_s* sdev, const unsigned int seconds) {
 
     // assumes 2 heartbeat messages per second (500ms delay)
     for (unsigned int toSend = seconds * 2; toSend > 0; toSend--) {
-        Serial_write(sdev, LOR_HEARTBEAT_BYTES, LOR_HEARTBEAT_SIZE);
+        for (int i = 0; i < count; i++)
+            Serial_write(sdevs[i], LOR_HEARTBEAT_BYTES, LOR_HEARTBEAT_SIZE);
 
 #ifdef _WIN32
         Sleep(LOR_HEARTBEAT_DELAY_MS);
@@ -81,19 +86,44 @@ int PU_writeHeartbeat(struct serialdev_s* sdev) {
     return FP_EOK;
 }
 
-int PU_writeEffect(struct serialdev_s* sdev,
-                   const struct ctgroup_s* group,
-                   uint32_t* accum) {
-    assert(sdev != NULL);
-    assert(group != NULL);
-    assert(group->size > 0);
-
+/// @enum pu_select_t
+/// @brief Forms an effect's channel selection may be encoded in.
+enum pu_select_t {
+    PU_SELECT_SINGLE, ///< Single channel number
+    PU_SELECT_LOW,    ///< Channel set of the low half of a section only
+    PU_SELECT_HIGH,   ///< Channel set of the high half of a section only
+    PU_SELECT_BOTH,   ///< Channel set of both halves of a section
+    PU_SELECT_COUNT,
+};
+
+/// @brief Encoded size of an effect by its channel selection form, and whether
+/// it is encoded as a set off effect rather than an intensity, measured from
+/// libtinylor's own encoding on first use.
+static size_t PU_costs[PU_SELECT_COUNT][2];
+
+static pthread_once_t PU_costsOnce = PTHREAD_ONCE_INIT;
+
+/// @brief Encodes a single LOR effect in the given form.
+/// @param group channel group state to encode
+/// @param select form of the channel selection, `PU_SELECT_SINGLE` requires
+/// the group to select a single channel
+/// @param off if true, the effect is encoded as a set off effect
+/// @param b buffer to write the encoded effect to
+/// @param size size of the buffer
+/// @return number of bytes written to the buffer
+static size_t PU_encodeAs(const struct ctgroup_s* group,
+                          const enum pu_select_t select,
+                          const bool off,
+                          uint8_t* b,
+                          const size_t size) {
     lor_req_s req = {0};
 
     lor_set_unit(&req, group->unit);
-    lor_set_intensity(&req, lor_get_intensity(group->intensity));
 
-    if (group->size > 1) {
+    if (off) lor_set_effect(&req, LOR_SET_OFF, NULL);
+    else lor_set_intensity(&req, lor_get_intensity(group->intensity));
+
+    if (select != PU_SELECT_SINGLE) {
         req.cset.offset = group->offset;// values already aligned, set directly
         req.cset.cbits = group->cs;
     } else {
@@ -102,23 +132,79 @@ int PU_writeEffect(struct serialdev_s* sdev,
         lor_set_channel(&req, channel);
     }
 
-    unsigned char b[32] = {0};
-    const size_t w = lor_write(b, sizeof(b), &req, 1);
+    return lor_write(b, size, &req, 1);
+}
 
-    Serial_write(sdev, b, w);
+/// @brief Measures the encoded size of an effect in each form.
+static void PU_measureCosts(void) {
+    // sample channel selections of each form
+    static const uint16_t samples[PU_SELECT_COUNT] = {0x0001, 0x0003, 0x0300,
+                                                      0x0101};
+
+    uint8_t b[PU_EFFECT_MAX];
+    for (int i = 0; i < PU_SELECT_COUNT; i++) {
+        const struct ctgroup_s sample = {
+                .unit = 1,
+                .cs = samples[i],
+                .intensity = 0x80,
+                .size = __builtin_popcount(samples[i]),
+        };
+        for (int off = 0; off < 2; off++)
+            PU_costs[i][off] = PU_encodeAs(&sample, (enum pu_select_t) i, off,
+                                           b, sizeof(b));
+    }
+}
 
-    if (accum != NULL) *accum += w;
+void PU_intensityLevels(uint8_t* levels) {
+    assert(levels != NULL);
 
-    return FP_EOK;
+    for (int i = 0; i < 256; i++) levels[i] = lor_get_intensity((uint8_t) i);
+}
+
+size_t PU_encodeEffect(const struct ctgroup_s* group,
+                       uint8_t* b,
+                       const size_t size) {
+    assert(group != NULL);
+    assert(group->size > 0);
+    assert(b != NULL);
+    assert(size >= PU_EFFECT_MAX);
+
+    pthread_once(&PU_costsOnce, PU_measureCosts);
+
+    // channel set form of the group's selection
+    enum pu_select_t set = PU_SELECT_BOTH;
+    if ((group->cs >> 8) == 0) set = PU_SELECT_LOW;
+    else if ((group->cs & 0xFF) == 0) set = PU_SELECT_HIGH;
+
+    // each effect is encoded in its shortest equivalent form, a single channel
+    // may also be selected by a channel set, and an intensity that turns the
+    // channels off may be sent as a set off effect instead
+    const bool single = group->size == 1;
+
+    enum pu_select_t select = single ? PU_SELECT_SINGLE : set;
+    if (single && PU_costs[set][0] < PU_costs[select][0]) select = set;
+
+    bool off = false;
+    if (lor_get_intensity(group->intensity) == lor_get_intensity(0)) {
+        enum pu_select_t s = set;
+        if (single && PU_costs[PU_SELECT_SINGLE][1] <= PU_costs[set][1])
+            s = PU_SELECT_SINGLE;
+        if (PU_costs[s][1] < PU_costs[select][0]) select = s, off = true;
+    }
+
+    return PU_encodeAs(group, select, off, b, size);
 }
 
-int PU_playFirstAudio(const char* audiofp,
+int PU_loadFirstAudio(const char* audiofp,
                       struct FC* fc,
-                      const struct tf_header_t* seq) {
+                      const struct tf_header_t* seq,
+                      const uint32_t frame) {
     assert(fc != NULL);
     assert(seq != NULL);
 
-    if (audiofp != NULL) return Audio_play(audiofp);
+    const float offset = (float) frame * seq->frameStepTimeMillis / 1000.0f;
+
+    if (audiofp != NULL) return Audio_load(audiofp, offset);
 
     char* lookup = NULL;
 
@@ -127,8 +213,8 @@ int PU_playFirstAudio(const char* audiofp,
     if ((err = Seq_getMediaFile(fc, seq, &lookup))) return err;
     if (lookup == NULL) return FP_EOK;// nothing to play
 
-    err = Audio_play(lookup);
-    free(lookup);// unused once playback is started
+    err = Audio_load(lookup, offset);
+    free(lookup);// unused once the audio is loaded
 
     return err;
 }
@@ -3,6 +3,7 @@
 #ifndef FPLAYER_PUTIL_H
 #define FPLAYER_PUTIL_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 struct serialdev_s;
@@ -11,10 +12,11 @@ struct serialdev_s;
 /// LOR heartbeat messages will intentionally be sent during this time. This
 /// function is used to ensure the LOR hardware is connected to the player
 /// before sending playback commands.
-/// @param sdev serial device to write the heartbeat messages to
+/// @param sdevs serial devices to write the heartbeat messages to
+/// @param count number of entries in `sdevs`
 /// @param seconds number of seconds to wait
 /// @return 0 on success, a negative error code on failure
-int PU_wait(struct serialdev_s* sdev, unsigned int seconds);
+int PU_wait(struct serialdev_s* const* sdevs, int count, unsigned int seconds);
 
 /// @brief Turns off all lights by sending a set off effect to all LOR units.
 /// @param sdev serial device to write the command to
@@ -37,29 +39,41 @@ int PU_writeHeartbeat(struct serialdev_s* sdev);
 
 struct ctgroup_s;
 
+/// @def PU_EFFECT_MAX
+/// @brief Maximum number of bytes written by `PU_encodeEffect`.
+#define PU_EFFECT_MAX 32
+
+/// @brief Fills a table of the LOR output level each intensity value is sent
+/// as. Distinct intensity values may share an output level.
+/// @param levels table of 256 entries to fill, indexed by intensity value
+void PU_intensityLevels(uint8_t* levels);
+
 /// @brief Encodes the given channel group state update to the provided message
-/// buffer as a LOR effect. The number of bytes written to the message buffer
-/// will be added to the optional accumulator parameter.
-/// @param sdev serial device to write the effect to
+/// buffer as a LOR effect. The effect is encoded in whichever equivalent form
+/// is shortest, by the encoded sizes measured from the LOR library on first
+/// use, such as selecting a single channel by a channel set, or turning
+/// channels off with a set off effect rather than an intensity.
 /// @param group channel group state to encode
-/// @param accum optional accumulator to store the number of bytes written
-/// @return 0 on success, a negative error code on failure
-int PU_writeEffect(struct serialdev_s* sdev,
-                   const struct ctgroup_s* group,
-                   uint32_t* accum);
+/// @param b buffer to write the encoded effect to
+/// @param size size of the buffer, at least `PU_EFFECT_MAX` bytes
+/// @return number of bytes written to the buffer
+size_t PU_encodeEffect(const struct ctgroup_s* group, uint8_t* b, size_t size);
 
 struct FC;
 
-/// @brief If audiofp is not NULL, this function will attempt to play the audio
+/// @brief If audiofp is not NULL, this function will attempt to load the audio
 /// file at the given path. If audiofp is NULL, this function will attempt to
-/// lookup the `mf` (media file) variable within the file controller and play
-/// the audio file at the path stored in the variable.
-/// @param audiofp suggested audio file path to play, or NULL to lookup from fc
+/// lookup the `mf` (media file) variable within the file controller and load
+/// the audio file at the path stored in the variable. The loaded audio is
+/// played once `Audio_start` is called.
+/// @param audiofp suggested audio file path to load, or NULL to lookup from fc
 /// @param fc file controller to read a fallback audio file from
 /// @param seq sequence header for file layout information
+/// @param frame index of the frame playback begins at, used to offset the audio
 /// @return 0 on success, a negative error code on failure
-int PU_playFirstAudio(const char* audiofp,
+int PU_loadFirstAudio(const char* audiofp,
                       struct FC* fc,
-                      const struct tf_header_t* seq);
+                      const struct tf_header_t* seq,
+                      uint32_t frame);
 
 #endif//FPLAYER_PUTIL_H
@@ -3,13 +3,31 @@
 #ifndef FPLAYER_QUEUE_H
 #define FPLAYER_QUEUE_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// @def Q_OUTPUT_MAX
+/// @brief Maximum number of outputs, each with its own channel map, driven by
+/// the playback of a single queue entry.
+#define Q_OUTPUT_MAX 8
+
 /// @struct qentry_s
 /// @brief Queue entry structure that holds playback configuration data.
 struct qentry_s {
-    const char* seqfp;    ///< Sequence file path
-    const char* audiofp;  ///< Audio override file path
-    const char* cmapfp;   ///< Channel map file path
-    unsigned int waitsec; ///< Playback start delay in seconds
+    const char* seqfp;     ///< Sequence file path
+    const char* audiofp;   ///< Audio override file path
+    unsigned int waitsec;  ///< Playback start delay in seconds
+    int lookahead;         ///< Compression blocks decoded concurrently
+    int blockwindow;       ///< Frames decoded per read of a block, or 0
+    size_t budget;         ///< Frame storage memory budget in bytes, or 0
+    size_t resident;       ///< Largest sequence held in memory in bytes, or 0
+    bool packed;           ///< Hold buffered frames packed in memory
+    unsigned int startsec; ///< Playback start offset in seconds
+    uint32_t startframe;   ///< Playback start frame, overrides \p startsec
+
+    const char* cmapfps[Q_OUTPUT_MAX]; ///< Channel map file path of each output
+    int outputs;                       ///< Number of entries in \p cmapfps
 };
 
 /// @struct q_s
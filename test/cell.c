@@ -1,9 +1,13 @@
 #undef NDEBUG
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "tinyfseq.h"
+
 #include "cell.h"
 #include "crmap.h"
+#include "fseq/fd.h"
 
 #define ISIZE 16
 
@@ -19,26 +23,22 @@ static void Pop_setAll(struct ctable_s* table, const uint8_t intensity) {
 
 static void Test_setAll(struct ctable_s* table, const uint8_t target) {
     /// This configures the entire table with the same intensity value. The table
-    /// is then linked, and the first group is extracted. The group should contain
-    /// the entire table, with the matching intensity value, expected number of
-    /// results, and correctly encoded network protocol data. No further groups
-    /// should be available after the first.
+    /// is then grouped. The single group should contain the entire table, with
+    /// the matching intensity value, expected number of results, and correctly
+    /// encoded network protocol data. No further groups should be available
+    /// until the table is modified again.
     Pop_setAll(table, target);
 
-    struct ctgroup_s group;
-
-    for (uint32_t at = 0; at < ISIZE; at++) {
-        if (at == 0) {
-            assert(CT_groupof(table, at, &group) == 1);
-            assert(group.size == ISIZE);
-            assert(group.unit == UNITID);
-            assert(group.offset == 0);
-            assert(group.cs == 0xFFFF);
-            assert(group.intensity == target);
-        } else {
-            assert(CT_groupof(table, at, &group) == 0);
-        }
-    }
+    const struct ctgroup_s* groups = NULL;
+
+    assert(CT_groups(table, &groups) == 1);
+    assert(groups[0].size == ISIZE);
+    assert(groups[0].unit == UNITID);
+    assert(groups[0].offset == 0);
+    assert(groups[0].cs == 0xFFFF);
+    assert(groups[0].intensity == target);
+
+    assert(CT_groups(table, &groups) == 0);
 }
 
 /// @brief Generates a half-and-half intensity table, where the first half of
@@ -59,34 +59,29 @@ static void Test_halfAndHalf(struct ctable_s* table,
                              const uint8_t low,
                              const uint8_t high) {
     /// This configures half the channel range with one value, and the other half
-    /// with another value. The table is then linked, and the first group is
-    /// extracted. The group should contain the first half of the table, with the
-    /// matching intensity value, expected number of results, and correctly
-    /// encoded network protocol data. This is repeated for the second half of the
-    /// table. No further groups should be available after the two.
+    /// with another value. The table is then grouped. The first group should
+    /// contain the first half of the table, with the matching intensity value,
+    /// expected number of results, and correctly encoded network protocol data.
+    /// The second group should contain the second half of the table. No further
+    /// groups should be available after the two.
     Pop_halfAndHalf(table, low, high);
 
-    struct ctgroup_s group;
-
-    for (uint32_t at = 0; at < ISIZE; at++) {
-        if (at == 0) {
-            assert(CT_groupof(table, at, &group) == 1);
-            assert(group.size == ISIZE / 2);
-            assert(group.unit == UNITID);
-            assert(group.offset == 0);
-            assert(group.cs == 0x00FF);
-            assert(group.intensity == low);
-        } else if (at == ISIZE / 2) {
-            assert(CT_groupof(table, at, &group) == 1);
-            assert(group.size == ISIZE / 2);
-            assert(group.unit == UNITID);
-            assert(group.offset == 0);
-            assert(group.cs == 0xFF00);
-            assert(group.intensity == high);
-        } else {
-            assert(CT_groupof(table, at, &group) == 0);
-        }
-    }
+    const struct ctgroup_s* groups = NULL;
+
+    assert(CT_groups(table, &groups) == 2);
+    assert(groups[0].size == ISIZE / 2);
+    assert(groups[0].unit == UNITID);
+    assert(groups[0].offset == 0);
+    assert(groups[0].cs == 0x00FF);
+    assert(groups[0].intensity == low);
+
+    assert(groups[1].size == ISIZE / 2);
+    assert(groups[1].unit == UNITID);
+    assert(groups[1].offset == 0);
+    assert(groups[1].cs == 0xFF00);
+    assert(groups[1].intensity == high);
+
+    assert(CT_groups(table, &groups) == 0);
 }
 
 /// @brief Generates an alternating intensity table, where the intensity value
@@ -106,33 +101,212 @@ static void Test_alternating(struct ctable_s* table,
                              const uint8_t low,
                              const uint8_t high) {
     // This configures the table with an alternating intensity value. The table is
-    // then linked, and the first group is extracted. The group should contain the
-    // half the table corresponding to the low intensity value, with the matching
-    // channel bitmask layout. This is repeated for the high intensity value. No
-    // further groups should be available after the two.
+    // then grouped. The first group should contain the half the table
+    // corresponding to the low intensity value, with the matching channel
+    // bitmask layout, and the second group the high intensity value. No further
+    // groups should be available after the two.
     Pop_alternating(table, low, high);
 
-    struct ctgroup_s group;
-
-    for (uint32_t at = 0; at < ISIZE; at++) {
-        if (at == 0) {
-            assert(CT_groupof(table, at, &group) == 1);
-            assert(group.size == ISIZE / 2);
-            assert(group.unit == UNITID);
-            assert(group.offset == 0);
-            assert(group.cs == 0x5555);
-            assert(group.intensity == low);
-        } else if (at == 1) {
-            assert(CT_groupof(table, at, &group) == 1);
-            assert(group.size == ISIZE / 2);
-            assert(group.unit == UNITID);
-            assert(group.offset == 0);
-            assert(group.cs == 0xAAAA);
-            assert(group.intensity == high);
-        } else {
-            assert(CT_groupof(table, at, &group) == 0);
-        }
-    }
+    const struct ctgroup_s* groups = NULL;
+
+    assert(CT_groups(table, &groups) == 2);
+    assert(groups[0].size == ISIZE / 2);
+    assert(groups[0].unit == UNITID);
+    assert(groups[0].offset == 0);
+    assert(groups[0].cs == 0x5555);
+    assert(groups[0].intensity == low);
+
+    assert(groups[1].size == ISIZE / 2);
+    assert(groups[1].unit == UNITID);
+    assert(groups[1].offset == 0);
+    assert(groups[1].cs == 0xAAAA);
+    assert(groups[1].intensity == high);
+
+    assert(CT_groups(table, &groups) == 0);
+}
+
+static void Test_unordered(struct ctable_s* table) {
+    // This changes the second half of the table before the first half, with
+    // the same intensity value in both. The single group should contain every
+    // changed cell, and unchanged cells should not be grouped again.
+    for (int i = ISIZE / 2; i < ISIZE; i++) CT_change(table, i, 0x10);
+    for (int i = 0; i < ISIZE / 4; i++) CT_change(table, i, 0x10);
+    CT_change(table, 0, 0x10);// unchanged, already recorded
+
+    const struct ctgroup_s* groups = NULL;
+
+    assert(CT_groups(table, &groups) == 1);
+    assert(groups[0].size == ISIZE / 2 + ISIZE / 4);
+    assert(groups[0].cs == 0xFF0F);
+    assert(groups[0].intensity == 0x10);
+
+    for (int i = 0; i < ISIZE; i++) CT_change(table, i, 0x10);
+    assert(CT_groups(table, &groups) == 1);
+    assert(groups[0].cs == 0x00F0 && groups[0].size == ISIZE / 4);
+}
+
+static void Test_sparse(const struct cr_s* cr) {
+    // This maps a sparse frame that stores the second half of the channel map
+    // first, followed by a quarter from the start, and four trailing indexes
+    // that no range stores. The frame indexes should be translated to the
+    // stored sequence indexes before lookup, and unstored indexes ignored.
+    const TFChannelRange ranges[] = {
+            {.firstChannelNumber = ISIZE / 2, .channelCount = ISIZE / 2},
+            {.firstChannelNumber = 0, .channelCount = ISIZE / 4},
+    };
+
+    struct ctable_s* table = NULL;
+    assert(CT_init(cr, ISIZE, ranges, 2, &table) == 0);
+
+    Pop_halfAndHalf(table, 0, 0xFF);
+
+    const struct ctgroup_s* groups = NULL;
+
+    assert(CT_groups(table, &groups) == 2);
+    assert(groups[0].size == ISIZE / 2);
+    assert(groups[0].unit == UNITID);
+    assert(groups[0].offset == 0);
+    assert(groups[0].cs == 0xFF00);
+    assert(groups[0].intensity == 0);
+
+    assert(groups[1].size == ISIZE / 4);
+    assert(groups[1].unit == UNITID);
+    assert(groups[1].offset == 0);
+    assert(groups[1].cs == 0x000F);
+    assert(groups[1].intensity == 0xFF);
+
+    assert(CT_groups(table, &groups) == 0);
+
+    CT_free(table);
+}
+
+static void Test_apply(const struct cr_s* cr) {
+    // This applies frames storing two ranges of the table, a quarter from the
+    // start and the second half. Only cells whose value differs from their
+    // current intensity should be grouped, and reapplying the same frame should
+    // not modify any cell.
+    const struct fd_range_s ranges[] = {
+            {.first = 0, .count = ISIZE / 4},
+            {.first = ISIZE / 2, .count = ISIZE / 2},
+    };
+
+    struct ctable_s* table = NULL;
+    assert(CT_init(cr, ISIZE, NULL, 0, &table) == 0);
+
+    const struct ctgroup_s* groups = NULL;
+    assert(CT_groups(table, &groups) == 1);
+
+    uint8_t frame[ISIZE / 4 + ISIZE / 2] = {0x10, 0x10};
+    memset(&frame[ISIZE / 4], 0x20, ISIZE / 2);
+
+    CT_apply(table, ranges, 2, frame);
+    assert(CT_groups(table, &groups) == 2);
+    assert(groups[0].cs == 0x0003 && groups[0].intensity == 0x10);
+    assert(groups[1].cs == 0xFF00 && groups[1].intensity == 0x20);
+    assert(groups[1].size == ISIZE / 2);
+
+    CT_apply(table, ranges, 2, frame);
+    assert(CT_groups(table, &groups) == 0);
+
+    frame[ISIZE / 4 + 1] = 0x30;
+    CT_apply(table, ranges, 2, frame);
+    assert(CT_groups(table, &groups) == 1);
+    assert(groups[0].cs == 0x0200 && groups[0].size == 1);
+    assert(groups[0].intensity == 0x30);
+
+    CT_free(table);
+}
+
+static void Test_interleaved(void) {
+    // This maps the middle of the table to a second unit, splitting the first
+    // unit's section around it. Each section should be grouped separately, and
+    // the groups returned in the order of their first index, as if the table
+    // was scanned in order.
+    struct cr_s* cr = NULL;
+    assert(CMap_read("../test/split_channels.json", &cr) == 0);
+
+    struct ctable_s* table = NULL;
+    assert(CT_init(cr, ISIZE, NULL, 0, &table) == 0);
+
+    const struct ctgroup_s* groups = NULL;
+    assert(CT_groups(table, &groups) == 2);
+    assert(groups[0].unit == UNITID && groups[0].cs == 0x0FFF);
+    assert(groups[1].unit == UNITID + 1 && groups[1].cs == 0x000F);
+
+    for (int i = 0; i < ISIZE; i++)
+        CT_change(table, i, i < 8 ? 0x10 : i < 12 ? 0x20 : 0x30);
+
+    assert(CT_groups(table, &groups) == 3);
+    assert(groups[0].unit == UNITID && groups[0].intensity == 0x10);
+    assert(groups[0].cs == 0x00FF && groups[0].size == 8);
+    assert(groups[1].unit == UNITID + 1 && groups[1].intensity == 0x20);
+    assert(groups[1].cs == 0x000F && groups[1].size == 4);
+    assert(groups[2].unit == UNITID && groups[2].intensity == 0x30);
+    assert(groups[2].cs == 0x0F00 && groups[2].size == 4);
+
+    assert(CT_groups(table, &groups) == 0);
+
+    CT_free(table);
+    CMap_free(cr);
+}
+
+static void Test_levels(const struct cr_s* cr) {
+    // This outputs each pair of intensity values at the same level. Changes
+    // within a level should not modify a cell, and cells of the same level
+    // should be grouped together, as the intensity of the first cell.
+    struct ctable_s* table = NULL;
+    assert(CT_init(cr, ISIZE, NULL, 0, &table) == 0);
+
+    uint8_t levels[256];
+    for (int i = 0; i < 256; i++) levels[i] = (uint8_t) (i / 2);
+    CT_setLevels(table, levels);
+
+    const struct ctgroup_s* groups = NULL;
+    assert(CT_groups(table, &groups) == 1);
+
+    for (int i = 0; i < ISIZE; i++) CT_change(table, i, 0x11 - i % 2);
+    assert(CT_groups(table, &groups) == 1);
+    assert(groups[0].cs == 0xFFFF && groups[0].size == ISIZE);
+    assert(groups[0].intensity == 0x11);
+
+    for (int i = 0; i < ISIZE; i++) CT_change(table, i, 0x10);
+    assert(CT_groups(table, &groups) == 0);
+
+    CT_change(table, 3, 0x12);
+    assert(CT_groups(table, &groups) == 1);
+    assert(groups[0].cs == 0x0008 && groups[0].intensity == 0x12);
+
+    CT_free(table);
+}
+
+static void Test_ranges(const struct cr_s* cr) {
+    // This maps a sparse frame with a hole of four unmapped indexes in the
+    // middle, and four trailing indexes that no range stores. The configured
+    // ranges should exclude both, unless the hole is small enough to merge.
+    const TFChannelRange sparse[] = {
+            {.firstChannelNumber = 0, .channelCount = 4},
+            {.firstChannelNumber = ISIZE * 2, .channelCount = 4},
+            {.firstChannelNumber = 4, .channelCount = 4},
+    };
+
+    struct ctable_s* table = NULL;
+    assert(CT_init(cr, ISIZE, sparse, 3, &table) == 0);
+
+    struct fd_range_s* ranges = NULL;
+    int count = 0;
+
+    assert(CT_ranges(table, 3, &ranges, &count) == 0);
+    assert(count == 2);
+    assert(ranges[0].first == 0 && ranges[0].count == 4);
+    assert(ranges[1].first == 8 && ranges[1].count == 4);
+    free(ranges);
+
+    assert(CT_ranges(table, 4, &ranges, &count) == 0);
+    assert(count == 1);
+    assert(ranges[0].first == 0 && ranges[0].count == 12);
+    free(ranges);
+
+    CT_free(table);
 }
 
 int main(int argc, char** argv) {
@@ -143,7 +317,7 @@ int main(int argc, char** argv) {
     assert(CMap_read("../test/default_channels.json", &cr) == 0);
 
     struct ctable_s* table = NULL;
-    assert(CT_init(cr, ISIZE, &table) == 0);
+    assert(CT_init(cr, ISIZE, NULL, 0, &table) == 0);
 
     Test_setAll(table, 0);
     Test_setAll(table, 255);
@@ -154,8 +328,18 @@ int main(int argc, char** argv) {
     Test_alternating(table, 0, 0xFF);
     Test_alternating(table, 0xFF, 0x00);
 
+    Test_unordered(table);
+
     CT_free(table);
+
+    Test_sparse(cr);
+    Test_apply(cr);
+    Test_levels(cr);
+    Test_ranges(cr);
+
     CMap_free(cr);
 
+    Test_interleaved();
+
     return 0;
 }
@@ -0,0 +1,93 @@
+#undef NDEBUG
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "diff.h"
+
+#define FSIZE 200
+
+/// @brief Runs the frame size, alignment and tail checks against the given
+/// kernel, comparing its results with those of the scalar kernel.
+/// @param kernel index of the kernel to check
+static void Test_kernel(const int kernel) {
+    uint8_t prev[FSIZE + DF_BLOCK], next[FSIZE + DF_BLOCK];
+    uint32_t changed[DF_WORDS(FSIZE)], expected[DF_WORDS(FSIZE)];
+
+    // identical frames have no changed bytes, at any size and alignment
+    for (int i = 0; i < FSIZE + DF_BLOCK; i++) prev[i] = next[i] = (uint8_t) i;
+    assert(DF_diffWith(kernel, prev, next, 0, changed) == 0);
+    for (uint32_t size = 1; size <= FSIZE; size++) {
+        memset(changed, 0xFF, sizeof(changed));
+        assert(DF_diffWith(kernel, &prev[size % 7], &next[size % 7], size,
+                           changed) == 0);
+        for (uint32_t w = 0; w < DF_WORDS(size); w++) assert(changed[w] == 0);
+    }
+
+    // each changed byte is marked in its own bit, including bytes in the
+    // partial block at the end of the frame
+    for (uint32_t size = 1; size <= FSIZE; size++) {
+        const uint32_t offset = size % 5;
+        uint32_t n = 0;
+        memcpy(next, prev, sizeof(next));
+        for (uint32_t i = 0; i < size; i++)
+            if ((i * 7 + size) % 3 == 0) next[offset + i] ^= 0x80, n++;
+
+        assert(DF_diffWith(kernel, &prev[offset], &next[offset], size,
+                           changed) == n);
+        for (uint32_t i = 0; i < size; i++) {
+            const int bit = changed[i / DF_BLOCK] >> (i % DF_BLOCK) & 1;
+            assert(bit == (prev[offset + i] != next[offset + i]));
+        }
+    }
+
+    // random changes at every alignment match the scalar kernel bit for bit
+    srand(kernel + 1);
+    for (uint32_t size = 1; size <= FSIZE; size++) {
+        const uint32_t offset = size % DF_BLOCK;
+        for (int i = 0; i < FSIZE + DF_BLOCK; i++) {
+            prev[i] = (uint8_t) rand();
+            next[i] = rand() % 4 == 0 ? (uint8_t) rand() : prev[i];
+        }
+
+        const uint32_t n = DF_diffWith(0, &prev[offset], &next[offset], size,
+                                       expected);
+        assert(DF_diffWith(kernel, &prev[offset], &next[offset], size,
+                           changed) == n);
+        assert(memcmp(changed, expected, DF_WORDS(size) * sizeof(uint32_t)) ==
+               0);
+    }
+
+    // bytes past the end of the frame are never compared
+    for (int i = 0; i < FSIZE + DF_BLOCK; i++) prev[i] = next[i] = (uint8_t) i;
+    next[40] ^= 1;
+    assert(DF_diffWith(kernel, prev, next, 40, changed) == 0);
+    assert(DF_diffWith(kernel, prev, next, 41, changed) == 1 &&
+           changed[1] == 1 << 8);
+}
+
+int main(int argc, char** argv) {
+    (void) argc;
+    (void) argv;
+
+    // the scalar kernel is always first, and the widest is used by DF_diff
+    assert(DF_kernel() != NULL);
+    assert(strcmp(DF_kernelAt(0), "scalar") == 0);
+
+    int count = 0;
+    while (DF_kernelAt(count) != NULL) Test_kernel(count++);
+    assert(strcmp(DF_kernelAt(count - 1), DF_kernel()) == 0);
+
+    // the selected kernel is the one used by DF_diff
+    uint8_t prev[FSIZE], next[FSIZE];
+    uint32_t changed[DF_WORDS(FSIZE)], expected[DF_WORDS(FSIZE)];
+    for (int i = 0; i < FSIZE; i++) prev[i] = next[i] = (uint8_t) i;
+    next[3] ^= 1, next[FSIZE - 1] ^= 1;
+
+    assert(DF_diff(prev, next, FSIZE, changed) == 2);
+    assert(DF_diffWith(count - 1, prev, next, FSIZE, expected) == 2);
+    assert(memcmp(changed, expected, sizeof(changed)) == 0);
+
+    return 0;
+}
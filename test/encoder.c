@@ -0,0 +1,260 @@
+#undef NDEBUG
+#include <assert.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TINYFSEQ_IMPLEMENTATION
+#include "tinyfseq.h"
+
+#define TINYLOR_IMPL
+#include "tinylor.h"
+
+#include "cell.h"
+#include "crmap.h"
+#include "encoder.h"
+#include "fseq/fd.h"
+#include "fseq/seq.h"
+#include "fseq/writer.h"
+#include "pump.h"
+#include "putil.h"
+#include "std2/fc.h"
+
+#define CHANNELS 16
+#define FRAMES 31
+
+// via `default_channels.json`
+#define UNITID 20
+
+/// @struct test_enc_s
+/// @brief Encoder playing a test sequence, alongside everything it reads.
+struct test_enc_s {
+    uint8_t file[32 + CHANNELS * FRAMES]; ///< Test sequence file contents
+    struct FC* fc;                        ///< Test sequence file
+    struct seq_s* seq;                    ///< Opened test sequence
+    struct cr_s* cr;                      ///< Channel map
+    struct ctable_s* table;               ///< Cell table updated by the encoder
+    struct fd_range_s* ranges;            ///< Frame indexes kept by the pump
+    int rangeCount;                       ///< Number of entries in \p ranges
+    struct frame_pump_s* pump;            ///< Pump read by the encoder
+    struct encoder_s* enc;                ///< Encoder under test
+};
+
+/// @brief Writes an uncompressed test sequence of the given frames in memory,
+/// and starts an encoder playing it from the first frame.
+/// @param data channel data of every frame
+/// @param frames number of frames, at most `FRAMES`
+/// @param t test encoder to initialize
+static void Test_init(const uint8_t* data,
+                      const uint32_t frames,
+                      struct test_enc_s* t) {
+    struct tf_header_t header = {
+            .channelDataOffset = 32,
+            .majorVersion = 2,
+            .variableDataOffset = 32,
+            .channelCount = CHANNELS,
+            .frameCount = frames,
+            .frameStepTimeMillis = 25,
+            .compressionType = TF_COMPRESSION_NONE,
+    };
+
+    assert(frames <= FRAMES);
+    *t = (struct test_enc_s){0};
+
+    struct FC* fc = FC_openMem(t->file, sizeof(t->file), FC_MODE_WRITE);
+    assert(fc != NULL);
+    assert(fseqWriteHeader(fc, &header) == 0);
+    FC_close(fc);
+
+    memcpy(&t->file[header.channelDataOffset], data, frames * CHANNELS);
+
+    assert((t->fc = FC_openMem(t->file, sizeof(t->file), FC_MODE_READ)) !=
+           NULL);
+    assert(Seq_open(t->fc, &t->seq) == 0);
+    assert(CMap_read("../test/default_channels.json", &t->cr) == 0);
+    assert(CT_init(t->cr, CHANNELS, NULL, 0, &t->table) == 0);
+    assert(CT_ranges(t->table, 0, &t->ranges, &t->rangeCount) == 0);
+
+    const struct fp_opts_s opts = {.ranges = t->ranges,
+                                   .rangeCount = t->rangeCount};
+    assert(FP_init(t->fc, t->seq, &opts, &t->pump) == 0);
+
+    const struct en_source_s src = {.pump = t->pump};
+    assert(EN_init(&src, 0, t->table, t->ranges, t->rangeCount, &t->enc) == 0);
+}
+
+/// @brief Frees the encoder and everything it reads.
+/// @param t test encoder to free
+static void Test_free(struct test_enc_s* t) {
+    EN_free(t->enc);
+    FP_free(t->pump);
+    free(t->ranges);
+    CT_free(t->table);
+    CMap_free(t->cr);
+    Seq_free(t->seq);
+    FC_close(t->fc);
+}
+
+/// @brief Waits until the encoder has filled every slot ahead of playback.
+/// @param enc encoder to wait on
+static void Test_waitFull(struct encoder_s* enc) {
+    struct en_stats_s stats;
+    do {
+        sched_yield();
+        EN_getStats(enc, &stats);
+    } while (stats.ready < EN_DEPTH);
+}
+
+/// @brief Returns the output due at the given frame, waiting for the encoder
+/// thread to produce it.
+/// @param enc encoder to read from
+/// @param frame index of the frame to return
+/// @param b pointer to return the encoded bytes in, may be NULL
+/// @return number of encoded bytes due at the frame
+static uint32_t
+Test_next(struct encoder_s* enc, const uint32_t frame, const uint8_t** b) {
+    const uint8_t* view;
+    uint32_t size;
+
+    int err;
+    while ((err = EN_next(enc, frame, &view, &size)) == EN_MISSED)
+        sched_yield();
+    assert(err == 0);
+
+    if (b != NULL) *b = view;
+    return size;
+}
+
+/// @brief Returns the intensity every channel is set to by the given frame of
+/// the ramp sequence, which differs from the frame before it.
+/// @param frame index of the frame
+/// @return intensity of every channel
+static uint8_t Test_intensity(const uint32_t frame) {
+    return (uint8_t) (frame * 10 + 5);
+}
+
+/// @brief Encodes the effect expected for the given frame of the ramp
+/// sequence, which sets every channel of the unit to the same intensity.
+/// @param frame index of the frame
+/// @param b buffer of at least `PU_EFFECT_MAX` bytes to encode the effect into
+/// @return number of encoded bytes
+static uint32_t Test_expected(const uint32_t frame, uint8_t* b) {
+    const struct ctgroup_s group = {
+            .unit = UNITID,
+            .offset = 0,
+            .cs = 0xFFFF,
+            .intensity = Test_intensity(frame),
+            .size = CHANNELS,
+    };
+
+    return (uint32_t) PU_encodeEffect(&group, b, PU_EFFECT_MAX);
+}
+
+static void Test_ramp(void) {
+    /// Every frame of the ramp sequence sets all channels to a new intensity,
+    /// so each frame is output as a single effect. Requesting each frame at
+    /// its tick returns the frames in order, once the ring of encoded frames
+    /// has wrapped around several times, followed by the end of the sequence.
+    static uint8_t data[CHANNELS * FRAMES];
+    for (uint32_t frame = 0; frame < FRAMES; frame++)
+        memset(&data[frame * CHANNELS], Test_intensity(frame), CHANNELS);
+
+    struct test_enc_s t;
+    Test_init(data, FRAMES, &t);
+
+    for (uint32_t frame = 0; frame < FRAMES; frame++) {
+        uint8_t expected[PU_EFFECT_MAX];
+        const uint32_t n = Test_expected(frame, expected);
+
+        const uint8_t* b = NULL;
+        assert(Test_next(t.enc, frame, &b) == n);
+        assert(memcmp(b, expected, n) == 0);
+    }
+
+    const uint8_t* b = NULL;
+    uint32_t size = 0;
+    assert(EN_next(t.enc, FRAMES, &b, &size) == 1);
+    assert(EN_next(t.enc, FRAMES, &b, &size) == 1);
+
+    Test_free(&t);
+}
+
+static void Test_merge(void) {
+    /// Once the encoder has filled its ring, requesting the last of the
+    /// encoded frames returns every frame before it merged into a single view,
+    /// in order. The frames after it are not due yet, so requesting the same
+    /// tick again has nothing to return and is missed.
+    static uint8_t data[CHANNELS * FRAMES];
+    for (uint32_t frame = 0; frame < FRAMES; frame++)
+        memset(&data[frame * CHANNELS], Test_intensity(frame), CHANNELS);
+
+    struct test_enc_s t;
+    Test_init(data, FRAMES, &t);
+    Test_waitFull(t.enc);
+
+    uint8_t expected[PU_EFFECT_MAX * EN_DEPTH];
+    uint32_t n = 0;
+    for (uint32_t frame = 0; frame < EN_DEPTH; frame++)
+        n += Test_expected(frame, &expected[n]);
+
+    const uint8_t* b = NULL;
+    assert(Test_next(t.enc, EN_DEPTH - 1, &b) == n);
+    assert(memcmp(b, expected, n) == 0);
+
+    uint32_t size = 0;
+    assert(EN_next(t.enc, EN_DEPTH - 1, &b, &size) == EN_MISSED);
+    assert(b == NULL && size == 0);
+
+    // the following frame is output on its own at its tick
+    n = Test_expected(EN_DEPTH, expected);
+    assert(Test_next(t.enc, EN_DEPTH, &b) == n);
+    assert(memcmp(b, expected, n) == 0);
+
+    Test_free(&t);
+}
+
+static void Test_late(void) {
+    /// A sequence of blank frames, until a single channel is set and held by
+    /// every following frame. Nothing is requested until the ring is full, so
+    /// the encoder is blocked before reading the changed frame and every frame
+    /// up to the playhead is read late. The changed frame is only applied to
+    /// the table, and the following repeats must still output its change.
+    static uint8_t data[CHANNELS * FRAMES];
+    memset(data, 0, sizeof(data));
+
+    const uint32_t changed = 10, playhead = 20;
+    for (uint32_t frame = changed; frame < FRAMES; frame++)
+        data[frame * CHANNELS] = 0xFF;
+
+    struct test_enc_s t;
+    Test_init(data, FRAMES, &t);
+    Test_waitFull(t.enc);
+
+    // the blank frames encoded ahead of playback only output the initial state
+    // of every cell, and are merged into the output due at the playhead
+    assert(Test_next(t.enc, playhead, NULL) > 0);
+
+    uint32_t size = 0;
+    for (uint32_t frame = playhead + 1; frame < FRAMES; frame++)
+        size += Test_next(t.enc, frame, NULL);
+    assert(size > 0);
+
+    // frames after the playhead may also be passed before they are read
+    struct en_stats_s stats;
+    EN_getStats(t.enc, &stats);
+    assert(stats.late >= playhead - EN_DEPTH);
+
+    Test_free(&t);
+}
+
+int main(int argc, char** argv) {
+    (void) argc;
+    (void) argv;
+
+    Test_ramp();
+    Test_merge();
+    Test_late();
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+#undef NDEBUG
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+    #include <unistd.h>
+#endif
+
+#include <std2/fc.h>
+
+int main(int argc, char** argv) {
+    (void) argc;
+    (void) argv;
+
+    uint8_t data[64];
+    for (int i = 0; i < 64; i++) data[i] = (uint8_t) i;
+
+    struct FC* fc = FC_openMem(data, sizeof(data), FC_MODE_READ);
+    assert(fc != NULL);
+    assert(FC_filesize(fc) == sizeof(data));
+
+    // reads copy out of the buffer, stopping at its end
+    uint8_t b[64] = {0};
+    assert(FC_read(fc, 8, 4, b) == 4);
+    assert(b[0] == 8 && b[3] == 11);
+    assert(FC_read(fc, 60, 8, b) == 4 && b[0] == 60);
+    assert(FC_read(fc, 64, 1, b) == 0);
+
+    // readto counts only whole elements
+    assert(FC_readto(fc, 0, 16, 8, b) == 4);
+    assert(FC_readto(fc, 56, 16, 1, b) == 0);
+
+    // vectored reads scatter a contiguous range in order
+    uint8_t x[3], y[5];
+    const struct fc_iov_s iov[] = {{.b = x, .size = sizeof(x)},
+                                   {.b = y, .size = sizeof(y)}};
+    assert(FC_readv(fc, 10, iov, 2) == 8);
+    assert(x[0] == 10 && x[2] == 12 && y[0] == 13 && y[4] == 17);
+    assert(FC_readv(fc, 60, iov, 2) == 4);
+
+    // mapping returns the buffer itself
+    size_t size = 0;
+    assert(FC_map(fc, &size) == data && size == sizeof(data));
+    FC_advise(fc, 0, sizeof(data), FC_ADVICE_WILLNEED);
+
+    // read-only buffers are never written
+    assert(FC_write(fc, 0, 4, (const uint8_t*) "abcd") == 0);
+    assert(data[0] == 0);
+    FC_close(fc);
+
+    // writes copy into the buffer, stopping at its end
+    assert((fc = FC_openMem(data, sizeof(data), FC_MODE_WRITE)) != NULL);
+    assert(FC_write(fc, 62, 4, (const uint8_t*) "abcd") == 2);
+    assert(data[62] == 'a' && data[63] == 'b');
+    assert(FC_read(fc, 62, 2, b) == 2 && memcmp(b, "ab", 2) == 0);
+    FC_close(fc);
+
+    assert(FC_openMem(NULL, 0, FC_MODE_READ) == NULL);
+
+#ifndef _WIN32
+    // files beyond 4 GiB are mapped in full, the sparse tail reads as zeroes
+    if (SIZE_MAX > UINT32_MAX) {
+        const off_t large = (off_t) 5 << 30;
+
+        assert((fc = FC_open("test_fc.bin", FC_MODE_WRITE)) != NULL);
+        assert(FC_write(fc, 0, 4, (const uint8_t*) "abcd") == 4);
+        FC_close(fc);
+
+        if (truncate("test_fc.bin", large) == 0) {
+            assert((fc = FC_open("test_fc.bin", FC_MODE_READ)) != NULL);
+
+            const uint8_t* m = FC_map(fc, &size);
+            assert(m != NULL && size == (size_t) large);
+            assert(memcmp(m, "abcd", 4) == 0 && m[size - 1] == 0);
+            FC_advise(fc, size - 4096, 4096, FC_ADVICE_WILLNEED);
+            FC_close(fc);
+        }
+
+        remove("test_fc.bin");
+    }
+#endif
+
+    return 0;
+}
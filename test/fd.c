@@ -6,73 +6,113 @@
 
 #include <fseq/fd.h>
 
-static void free_node(struct fd_node_s* node) {
-    if (node == NULL) return;
-    free(node->frame);
-    free(node);
-}
-
 int main(int argc, char** argv) {
     (void) argc;
     (void) argv;
 
-    struct fd_list_s list = {0};
-
-    // shifting an empty list returns NULL
-    assert(FD_shift(&list) == NULL);
-    assert(list.head == NULL);
-    assert(list.count == 0);
-
-    // appending a frame to an empty list allocates a new node
-    uint8_t* frame1 = calloc(16, 1);
-    assert(frame1 != NULL);
-    assert(FD_append(&list, frame1) == 0);
-    assert(list.head != NULL);         // has item 1
-    assert(list.tail != NULL);         // has tail
-    assert(list.count == 1);           // has 1 item
-    assert(list.head->frame == frame1);// item 1 correct
-    assert(list.tail->frame == frame1);// item 1 correct
-    assert(list.head->next == NULL);   // no item 2 (expected)
-
-    // appending a frame to a non-empty list allocates a new node
-    uint8_t* frame2 = calloc(16, 1);
-    assert(frame2 != NULL);
-    assert(FD_append(&list, frame2) == 0);
-    assert(list.head != NULL);               // has item 1
-    assert(list.head != list.tail);          // has tail
-    assert(list.count == 2);                 // has 2 items total
-    assert(list.head->frame == frame1);      // item 1 correct
-    assert(list.head->next != NULL);         // has item 2
-    assert(list.head->next->frame == frame2);// item 2 correct
-    assert(list.head->next->next == NULL);   // no item 3 (expected)
-
-    struct fd_node_s* shifted;
-
-    // shift removes the first element and returns it
-    const struct fd_node_s* first = list.head;
-    shifted = FD_shift(&list);
-
-    assert(shifted == first);       // first element returned
-    assert(shifted->next == NULL);  // link listed data removed
-    assert(list.head != NULL);      // has item 2
-    assert(list.head == list.tail); // has tail
-    assert(list.head->next == NULL);// no item 3 (expected)
-    assert(list.count == 1);        // has 1 item remaining
-
-    free_node(shifted);
-
-    // shift removes the second element and returns it
-    const struct fd_node_s* second = list.head;
-    shifted = FD_shift(&list);
-
-    assert(first != second);      // first and second are different
-    assert(shifted == second);    // second element returned
-    assert(shifted->next == NULL);// link listed data removed
-    assert(list.head == NULL);    // no items left
-    assert(list.tail == NULL);    // no tail
-    assert(list.count == 0);      // no items remaining
-
-    free_node(shifted);
+    struct fd_ring_s ring;
+    assert(FD_init(&ring, 16, 4) == 0);
+
+    // slots are cache line aligned and padded
+    assert(ring.stride == FD_CACHE_LINE);
+    assert((uintptr_t) FD_slot(&ring, 0) % FD_CACHE_LINE == 0);
+    assert((uintptr_t) FD_slot(&ring, 1) % FD_CACHE_LINE == 0);
+    assert(FD_slot(&ring, 4) == FD_slot(&ring, 0));// indexes wrap
+
+    // shifting an empty ring returns NULL
+    assert(FD_shift(&ring) == NULL);
+    assert(ring.count == 0);
+
+    // one slot is always held back for the most recently shifted frame
+    assert(FD_space(&ring) == 3);
+
+    // writing to the tail slots does not publish them until committed
+    for (int i = 0; i < 3; i++)
+        memset(FD_slot(&ring, FD_tail(&ring) + i), i + 1, 16);
+    assert(ring.count == 0);
+    assert(FD_shift(&ring) == NULL);
+
+    FD_commit(&ring, 3);
+    assert(ring.count == 3);
+    assert(FD_space(&ring) == 0);
+
+    // shift returns frames in the order they were written
+    const uint8_t* frame = FD_shift(&ring);
+    assert(frame != NULL);
+    assert(frame[0] == 1 && frame[15] == 1);
+    assert(ring.count == 2);
+    assert(FD_space(&ring) == 1);
+
+    // the tail wraps around to reuse the freed slot
+    assert(FD_tail(&ring) == 3);
+    memset(FD_slot(&ring, FD_tail(&ring)), 4, 16);
+    FD_commit(&ring, 1);
+    assert(FD_space(&ring) == 0);
+
+    assert((frame = FD_shift(&ring)) != NULL && frame[0] == 2);
+    assert((frame = FD_shift(&ring)) != NULL && frame[0] == 3);
+    assert((frame = FD_shift(&ring)) != NULL && frame[0] == 4);
+    assert(FD_shift(&ring) == NULL);
+    assert(ring.count == 0);
+    assert(FD_space(&ring) == 3);
+
+    // discarding skips the oldest frames, wrapping the head
+    for (int i = 0; i < 3; i++)
+        memset(FD_slot(&ring, FD_tail(&ring) + i), i + 5, 16);
+    FD_commit(&ring, 3);
+    FD_discard(&ring, 2);
+    assert(ring.count == 1);
+    assert((frame = FD_shift(&ring)) != NULL && frame[0] == 7);
+    FD_discard(&ring, 0);
+    assert(FD_shift(&ring) == NULL);
+
+    // projection copies each range consecutively
+    const uint8_t full[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    const struct fd_range_s ranges[] = {{.first = 1, .count = 2},
+                                        {.first = 6, .count = 2}};
+    uint8_t compact[4] = {0};
+    assert(FD_project(ranges, 2, full, compact) == 4);
+    assert(compact[0] == 1 && compact[1] == 2);
+    assert(compact[2] == 6 && compact[3] == 7);
+
+    // packed frames expand to the frames they were packed from
+    uint8_t frames[4][16] = {{0}};
+    for (int i = 0; i < 16; i++) frames[0][i] = frames[1][i] = (uint8_t) i;
+    memcpy(frames[2], frames[0], 16);
+    frames[2][3] = 0xFF, frames[2][12] = 0xFE;// frames[3] is blank
+
+    struct fd_pack_s pack;
+    assert(FD_initPack(&pack, 16) == 0);
+    for (int i = 0; i < 4; i++) {
+        const uint32_t size = pack.size;
+        memcpy(FD_packSlot(&pack), frames[i], 16);
+        assert(FD_pack(&pack) == 0);
+        if (i == 1) assert(pack.size - size <= 2);// repeats are a single skip
+    }
+    assert(pack.count == 4);
+
+    uint8_t out[16];
+    memset(out, 0xAA, sizeof(out));
+    assert(FD_unpack(&pack, out) && memcmp(out, frames[0], 16) == 0);
+    assert(!FD_unpack(&pack, out) && memcmp(out, frames[1], 16) == 0);
+    assert(FD_unpack(&pack, out) && memcmp(out, frames[2], 16) == 0);
+    assert(FD_unpack(&pack, out) && memcmp(out, frames[3], 16) == 0);
+    assert(pack.read == 4 && pack.pos == pack.size);
+
+    // reset sets begin again from a blank frame
+    FD_resetPack(&pack);
+    memcpy(FD_packSlot(&pack), frames[2], 16);
+    assert(FD_pack(&pack) == 0);
+    assert(FD_unpack(&pack, out) && memcmp(out, frames[2], 16) == 0);
+    FD_freePack(&pack);
+
+    // frame sizes are rounded up to the next cache line
+    FD_free(&ring);
+    assert(FD_init(&ring, FD_CACHE_LINE + 1, 2) == 0);
+    assert(ring.stride == FD_CACHE_LINE * 2);
+    assert(FD_stride(FD_CACHE_LINE + 1) == ring.stride);
+    assert(FD_stride(FD_CACHE_LINE) == FD_CACHE_LINE);
+    FD_free(&ring);
 
     return 0;
 }
@@ -0,0 +1,261 @@
+#undef NDEBUG
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define TINYFSEQ_IMPLEMENTATION
+#include "tinyfseq.h"
+
+#include "fseq/seq.h"
+#include "fseq/writer.h"
+#include "hub.h"
+#include "pump.h"
+#include "std2/errcode.h"
+#include "std2/fc.h"
+
+#define CHANNELS 8
+#define FRAMES (FH_DEPTH * 3)
+
+#define CONSUMERS 3
+
+/// @struct test_hub_s
+/// @brief Frame hub sharing an in-memory test sequence, alongside everything
+/// it reads.
+struct test_hub_s {
+    uint8_t file[40 + CHANNELS * FRAMES]; ///< Test sequence file contents
+    struct FC* fc;                        ///< Test sequence file
+    struct seq_s* seq;                    ///< Opened test sequence
+    struct frame_pump_s* pump;            ///< Pump read by the hub
+    struct frame_hub_s* hub;              ///< Hub under test
+};
+
+/// @struct test_consumer_s
+/// @brief Consumer of a hub read on its own thread until the hub returns an
+/// error or the end of the sequence.
+struct test_consumer_s {
+    struct frame_hub_s* hub; ///< Hub to read from
+    int index;               ///< Consumer index in \p hub
+    pthread_t thread;        ///< Thread reading the consumer
+    pthread_mutex_t lock;    ///< Guards all fields following \p lock
+    uint32_t frames;         ///< Number of frames read
+    int err;                 ///< Result of the final read
+};
+
+/// @brief Writes a test sequence in memory and starts a hub sharing it between
+/// the given number of consumers. Each pair of frames holds the index of the
+/// pair in every channel, so every odd frame repeats the frame before it.
+/// @param t test hub to initialize
+/// @param consumers number of consumers
+/// @param corrupt if true, the sequence is instead made of a single compressed
+/// block that fails to decode
+static void Test_init(struct test_hub_s* t,
+                      const int consumers,
+                      const bool corrupt) {
+    struct tf_header_t header = {
+            .channelDataOffset = 32,
+            .majorVersion = 2,
+            .variableDataOffset = 32,
+            .channelCount = CHANNELS,
+            .frameCount = FRAMES,
+            .frameStepTimeMillis = 25,
+            .compressionType = TF_COMPRESSION_NONE,
+    };
+
+    *t = (struct test_hub_s){0};
+
+    if (corrupt) {
+        header.channelDataOffset = header.variableDataOffset = 40;
+        header.compressionType = TF_COMPRESSION_ZSTD;
+        header.compressionBlockCount = 1;
+    }
+
+    struct FC* fc = FC_openMem(t->file, sizeof(t->file), FC_MODE_WRITE);
+    assert(fc != NULL);
+    assert(fseqWriteHeader(fc, &header) == 0);
+    if (corrupt) {
+        const struct tf_compression_block_t block = {.firstFrameId = 0,
+                                                     .size = 64};
+        assert(fseqWriteCompressionBlocks(fc, &header, &block) == 0);
+    }
+    FC_close(fc);
+
+    uint8_t* data = &t->file[header.channelDataOffset];
+    if (corrupt)
+        memset(data, 0xFF, 64);
+    else
+        for (uint32_t frame = 0; frame < FRAMES; frame++)
+            memset(&data[frame * CHANNELS], (int) (frame / 2), CHANNELS);
+
+    assert((t->fc = FC_openMem(t->file, sizeof(t->file), FC_MODE_READ)) !=
+           NULL);
+    assert(Seq_open(t->fc, &t->seq) == 0);
+    assert(FP_init(t->fc, t->seq, NULL, &t->pump) == 0);
+    assert(FH_init(t->pump, CHANNELS, consumers, &t->hub) == 0);
+}
+
+/// @brief Frees the hub and everything it reads.
+/// @param t test hub to free
+static void Test_free(struct test_hub_s* t) {
+    FH_free(t->hub);
+    FP_free(t->pump);
+    Seq_free(t->seq);
+    FC_close(t->fc);
+}
+
+/// @brief Thread entry point reading a consumer until the hub returns an error
+/// or the end of the sequence, checking each frame is returned in order.
+/// @param pargs consumer to read
+/// @return NULL
+static void* Test_consume(void* pargs) {
+    struct test_consumer_s* c = pargs;
+
+    int err;
+    for (uint32_t frame = 0;; frame++) {
+        const uint8_t* fd = NULL;
+        bool repeat = false;
+        if ((err = FH_next(c->hub, c->index, &fd, &repeat))) break;
+
+        for (int i = 0; i < CHANNELS; i++) assert(fd[i] == frame / 2);
+        assert(repeat == (frame % 2 == 1));
+
+        pthread_mutex_lock(&c->lock);
+        c->frames++;
+        pthread_mutex_unlock(&c->lock);
+    }
+
+    pthread_mutex_lock(&c->lock);
+    c->err = err;
+    pthread_mutex_unlock(&c->lock);
+
+    return NULL;
+}
+
+/// @brief Starts reading the given consumer of a hub on its own thread.
+/// @param c consumer to start
+/// @param hub hub to read from
+/// @param index consumer index in \p hub
+static void
+Test_start(struct test_consumer_s* c, struct frame_hub_s* hub, int index) {
+    *c = (struct test_consumer_s){.hub = hub, .index = index};
+    assert(pthread_mutex_init(&c->lock, NULL) == 0);
+    assert(pthread_create(&c->thread, NULL, Test_consume, c) == 0);
+}
+
+/// @brief Waits for the thread of the given consumer to exit.
+/// @param c consumer to wait on
+static void Test_join(struct test_consumer_s* c) {
+    assert(pthread_join(c->thread, NULL) == 0);
+    pthread_mutex_destroy(&c->lock);
+}
+
+/// @brief Returns the number of frames read by the given consumer so far.
+/// @param c consumer to check
+/// @return number of frames read
+static uint32_t Test_frames(struct test_consumer_s* c) {
+    pthread_mutex_lock(&c->lock);
+    const uint32_t frames = c->frames;
+    pthread_mutex_unlock(&c->lock);
+    return frames;
+}
+
+/// @brief Waits until the given consumer has read the given number of frames,
+/// then gives it time to read any further frames available to it.
+/// @param c consumer to wait on
+/// @param frames number of frames to wait for
+static void Test_settle(struct test_consumer_s* c, const uint32_t frames) {
+    const struct timespec ms = {.tv_nsec = 1000000};
+    while (Test_frames(c) < frames) nanosleep(&ms, NULL);
+
+    const struct timespec settle = {.tv_nsec = 50000000};
+    nanosleep(&settle, NULL);
+}
+
+static void Test_order(void) {
+    /// Every consumer reads every frame in order, followed by the end of the
+    /// sequence, which is also returned to any later read.
+    struct test_hub_s t;
+    Test_init(&t, CONSUMERS, false);
+
+    struct test_consumer_s c[CONSUMERS];
+    for (int i = 0; i < CONSUMERS; i++) Test_start(&c[i], t.hub, i);
+    for (int i = 0; i < CONSUMERS; i++) Test_join(&c[i]);
+
+    for (int i = 0; i < CONSUMERS; i++) {
+        assert(c[i].frames == FRAMES);
+        assert(c[i].err == 1);
+
+        const uint8_t* fd = NULL;
+        bool repeat = false;
+        assert(FH_next(t.hub, i, &fd, &repeat) == 1);
+    }
+
+    Test_free(&t);
+}
+
+static void Test_slow(void) {
+    /// A consumer that reads nothing holds the hub, and so every other
+    /// consumer, to `FH_DEPTH` frames ahead of it. Each frame it releases lets
+    /// the hub publish one more frame. Stopping the hub wakes the consumer left
+    /// waiting on a frame with the end of the sequence.
+    struct test_hub_s t;
+    Test_init(&t, 2, false);
+
+    struct test_consumer_s fast;
+    Test_start(&fast, t.hub, 1);
+
+    Test_settle(&fast, FH_DEPTH);
+    assert(Test_frames(&fast) == FH_DEPTH);
+
+    // the slow consumer only releases its first frame once it reads another
+    const uint8_t* fd = NULL;
+    bool repeat = false;
+    assert(FH_next(t.hub, 0, &fd, &repeat) == 0 && fd[0] == 0 && !repeat);
+    assert(FH_next(t.hub, 0, &fd, &repeat) == 0 && fd[0] == 0 && repeat);
+
+    Test_settle(&fast, FH_DEPTH + 1);
+    assert(Test_frames(&fast) == FH_DEPTH + 1);
+
+    FH_stop(t.hub);
+    Test_join(&fast);
+    assert(fast.frames == FH_DEPTH + 1);
+    assert(fast.err == 1);
+
+    assert(FH_next(t.hub, 0, &fd, &repeat) == 1);
+
+    Test_free(&t);
+}
+
+static void Test_error(void) {
+    /// A pump error is returned to every consumer, and to any later read.
+    struct test_hub_s t;
+    Test_init(&t, CONSUMERS, true);
+
+    struct test_consumer_s c[CONSUMERS];
+    for (int i = 0; i < CONSUMERS; i++) Test_start(&c[i], t.hub, i);
+    for (int i = 0; i < CONSUMERS; i++) Test_join(&c[i]);
+
+    for (int i = 0; i < CONSUMERS; i++) {
+        assert(c[i].frames == 0);
+        assert(c[i].err < 0 && c[i].err == c[0].err);
+
+        const uint8_t* fd = NULL;
+        bool repeat = false;
+        assert(FH_next(t.hub, i, &fd, &repeat) == c[0].err);
+    }
+
+    Test_free(&t);
+}
+
+int main(int argc, char** argv) {
+    (void) argc;
+    (void) argv;
+
+    Test_order();
+    Test_slow();
+    Test_error();
+
+    return 0;
+}
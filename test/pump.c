@@ -0,0 +1,103 @@
+#undef NDEBUG
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#define TINYFSEQ_IMPLEMENTATION
+#include "tinyfseq.h"
+
+#include "fseq/fd.h"
+#include "fseq/seq.h"
+#include "fseq/writer.h"
+#include "pump.h"
+#include "std2/errcode.h"
+#include "std2/fc.h"
+
+#define CHANNELS 16
+#define FRAMES 4
+
+/// @brief Initializes a pump keeping only the given ranges of each frame.
+/// @param fc file controller to read from
+/// @param seq sequence to read
+/// @param ranges frame bytes to keep
+/// @param count number of entries in `ranges`
+/// @return result of `FP_init`
+static int Test_initRanges(struct FC* fc,
+                           const struct seq_s* seq,
+                           const struct fd_range_s* ranges,
+                           const int count) {
+    const struct fp_opts_s opts = {.ranges = ranges, .rangeCount = count};
+
+    struct frame_pump_s* pump = NULL;
+    const int err = FP_init(fc, seq, &opts, &pump);
+    assert(err != 0 || pump != NULL);
+    FP_free(pump);
+
+    return err;
+}
+
+int main(int argc, char** argv) {
+    (void) argc;
+    (void) argv;
+
+    // an uncompressed sequence whose channels hold their own index
+    static uint8_t data[32 + CHANNELS * FRAMES];
+
+    struct tf_header_t header = {
+            .channelDataOffset = 32,
+            .majorVersion = 2,
+            .variableDataOffset = 32,
+            .channelCount = CHANNELS,
+            .frameCount = FRAMES,
+            .frameStepTimeMillis = 25,
+            .compressionType = TF_COMPRESSION_NONE,
+    };
+
+    struct FC* fc = FC_openMem(data, sizeof(data), FC_MODE_WRITE);
+    assert(fc != NULL);
+    assert(fseqWriteHeader(fc, &header) == 0);
+    FC_close(fc);
+
+    for (int i = 0; i < CHANNELS * FRAMES; i++)
+        data[header.channelDataOffset + i] = (uint8_t) (i % CHANNELS);
+
+    assert((fc = FC_openMem(data, sizeof(data), FC_MODE_READ)) != NULL);
+
+    struct seq_s* seq = NULL;
+    assert(Seq_open(fc, &seq) == 0);
+
+    // ranges are kept in order, up to the end of the frame
+    const struct fd_range_s kept[2] = {{2, 3}, {12, 4}};
+    const struct fp_opts_s opts = {.ranges = kept, .rangeCount = 2};
+
+    struct frame_pump_s* pump = NULL;
+    assert(FP_init(fc, seq, &opts, &pump) == 0);
+
+    const uint8_t* fd = NULL;
+    assert(FP_nextFrame(pump, &fd) == 0);
+    assert(memcmp(fd, (const uint8_t[]){2, 3, 4, 12, 13, 14, 15}, 7) == 0);
+    FP_free(pump);
+
+    // ranges beyond the end of the frame are rejected, including those
+    // starting past it
+    const struct fd_range_s past[1] = {{CHANNELS - 2, 3}};
+    assert(Test_initRanges(fc, seq, past, 1) == -FP_ERANGE);
+
+    const struct fd_range_s outside[1] = {{CHANNELS, 1}};
+    assert(Test_initRanges(fc, seq, outside, 1) == -FP_ERANGE);
+
+    const struct fd_range_s beyond[2] = {{0, 1}, {CHANNELS + 4, 1}};
+    assert(Test_initRanges(fc, seq, beyond, 2) == -FP_ERANGE);
+
+    // empty, overlapping and unordered ranges are rejected
+    const struct fd_range_s empty[1] = {{0, 0}};
+    assert(Test_initRanges(fc, seq, empty, 1) == -FP_ERANGE);
+
+    const struct fd_range_s overlap[2] = {{0, 4}, {3, 1}};
+    assert(Test_initRanges(fc, seq, overlap, 2) == -FP_ERANGE);
+
+    Seq_free(seq);
+    FC_close(fc);
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+#undef NDEBUG
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define TINYFSEQ_IMPLEMENTATION
+#include "tinyfseq.h"
+
+#define TINYLOR_IMPL
+#include "tinylor.h"
+
+#include "cell.h"
+#include "putil.h"
+
+#define UNITID 1
+
+/// @brief Encodes the effect of a channel group directly through libtinylor,
+/// in one of the naive forms it was encoded in before any minification.
+/// @param group channel group state to encode
+/// @param single if true, the group's only channel is selected by its number,
+/// otherwise the group's channel set is selected
+/// @param off if true, a set off effect is sent instead of the intensity
+/// @param b buffer of at least `PU_EFFECT_MAX` bytes to encode the effect into
+/// @return number of encoded bytes
+static size_t Test_encode(const struct ctgroup_s* group,
+                          const bool single,
+                          const bool off,
+                          uint8_t* b) {
+    lor_req_s req = {0};
+
+    lor_set_unit(&req, group->unit);
+
+    if (off) lor_set_effect(&req, LOR_SET_OFF, NULL);
+    else lor_set_intensity(&req, lor_get_intensity(group->intensity));
+
+    if (single) {
+        lor_set_channel(&req, __builtin_ctz(group->cs) + group->offset);
+    } else {
+        req.cset.offset = group->offset;
+        req.cset.cbits = group->cs;
+    }
+
+    return lor_write(b, PU_EFFECT_MAX, &req, 1);
+}
+
+/// @brief Checks the effect encoded for the given group is no longer than its
+/// naive channel set form, or single channel form if it selects one channel,
+/// and is the shortest of the forms selecting the same channels at the same
+/// output level.
+/// @param group channel group state to check
+static void Test_group(const struct ctgroup_s* group) {
+    uint8_t b[PU_EFFECT_MAX];
+    const size_t n = PU_encodeEffect(group, b, sizeof(b));
+    assert(n > 0);
+
+    const bool single = group->size == 1;
+
+    // an intensity sent at the level of 0 may also be sent as a set off effect
+    const uint8_t level = lor_get_intensity(group->intensity);
+    const bool off = level == lor_get_intensity(0);
+
+    uint8_t naive[PU_EFFECT_MAX];
+    assert(n <= Test_encode(group, false, false, naive));
+    if (single) assert(n <= Test_encode(group, true, false, naive));
+
+    // the encoding is one of the equivalent forms, and the shortest of them
+    bool found = false;
+    size_t shortest = SIZE_MAX;
+    for (int s = 0; s <= (int) single; s++) {
+        for (int o = 0; o <= (int) off; o++) {
+            uint8_t form[PU_EFFECT_MAX];
+            const size_t size = Test_encode(group, s, o, form);
+            if (size < shortest) shortest = size;
+            if (size == n && memcmp(form, b, n) == 0) found = true;
+        }
+    }
+
+    assert(found);
+    assert(n == shortest);
+}
+
+int main(int argc, char** argv) {
+    (void) argc;
+    (void) argv;
+
+    static const uint16_t sets[] = {0x0003, 0x00FF, 0x0300, 0xFF00,
+                                    0x0101, 0x8001, 0xFFFF};
+
+    for (int offset = 0; offset < 4; offset += 3) {
+        for (int intensity = 0; intensity < 256; intensity++) {
+            struct ctgroup_s group = {
+                    .unit = UNITID,
+                    .offset = (uint8_t) offset,
+                    .intensity = (uint8_t) intensity,
+            };
+
+            // every single channel of a section
+            for (int i = 0; i < 16; i++) {
+                group.cs = (uint16_t) (1 << i);
+                group.size = 1;
+                Test_group(&group);
+            }
+
+            // channel sets of either or both halves of a section
+            for (size_t i = 0; i < sizeof(sets) / sizeof(sets[0]); i++) {
+                group.cs = sets[i];
+                group.size = __builtin_popcount(sets[i]);
+                Test_group(&group);
+            }
+        }
+    }
+
+    return 0;
+}
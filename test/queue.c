@@ -10,9 +10,12 @@
 /// @param b second qentry_s struct to compare
 /// @return true if the structs contain the same data, false otherwise
 static bool entry_eq(const struct qentry_s* a, const struct qentry_s* b) {
+    if (a->outputs != b->outputs) return false;
+    for (int i = 0; i < a->outputs; i++)
+        if (strcmp(a->cmapfps[i], b->cmapfps[i]) != 0) return false;
+
     return strcmp(a->seqfp, b->seqfp) == 0 &&
-           strcmp(a->audiofp, b->audiofp) == 0 &&
-           strcmp(a->cmapfp, b->cmapfp) == 0 && a->waitsec == b->waitsec;
+           strcmp(a->audiofp, b->audiofp) == 0 && a->waitsec == b->waitsec;
 }
 
 int main(int argc, char** argv) {
@@ -25,7 +28,8 @@ int main(int argc, char** argv) {
     const struct qentry_s first = {
             .seqfp = "first.fseq",
             .audiofp = "first.wav",
-            .cmapfp = "first.json",
+            .cmapfps = {"first.json"},
+            .outputs = 1,
             .waitsec = 1,
     };
     assert(Q_append(q, first) == 0);
@@ -33,7 +37,8 @@ int main(int argc, char** argv) {
     const struct qentry_s second = {
             .seqfp = "second.fseq",
             .audiofp = "second.wav",
-            .cmapfp = "second.json",
+            .cmapfps = {"second.json", "second_b.json"},
+            .outputs = 2,
             .waitsec = 2,
     };
     assert(Q_append(q, second) == 0);